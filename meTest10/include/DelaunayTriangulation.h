@@ -0,0 +1,433 @@
+#ifndef DELAUNAY_TRIANGULATION_H
+#define DELAUNAY_TRIANGULATION_H
+
+#include <vector>
+#include <cmath>
+#include <cfloat>
+
+//Dynamic 2D Delaunay triangulation with point insertion and removal
+//Points are inserted by splitting the containing triangle then flipping illegal edges (Lawson)
+//Points are removed by clipping Delaunay ears from the polygon of their neighbours
+//Everything sits inside a large super triangle whose three vertices are never removed
+class DelaunayTriangulation
+{
+	public:
+		//Set up the super triangle around the region the points will occupy
+		DelaunayTriangulation( double MinX, double MaxX, double MinY, double MaxY )
+		{
+			double const centreX = 0.5 * ( MinX + MaxX );
+			double const centreY = 0.5 * ( MinY + MaxY );
+			double const size = 10.0 * ( ( MaxX - MinX ) + ( MaxY - MinY ) + 1.0 );
+			this->AddVertex( centreX - 2.0 * size, centreY - size );
+			this->AddVertex( centreX + 2.0 * size, centreY - size );
+			this->AddVertex( centreX, centreY + 2.0 * size );
+			int const first = this->AddTriangle( 0, 1, 2, -1, -1, -1 );
+			m_vertexTriangles[ 0 ] = m_vertexTriangles[ 1 ] = m_vertexTriangles[ 2 ] = first;
+		}
+
+		//Super triangle vertices are not real points
+		bool IsSuperVertex( unsigned int Vertex ) const
+		{
+			return ( Vertex < 3 );
+		}
+
+		double X( unsigned int Vertex ) const
+		{
+			return m_xs[ Vertex ];
+		}
+		double Y( unsigned int Vertex ) const
+		{
+			return m_ys[ Vertex ];
+		}
+
+		//Vertex ids are recycled after removal, this is the largest id ever used plus one
+		unsigned int VertexCapacity() const
+		{
+			return m_xs.size();
+		}
+
+		//Add a point, walking from the triangle of the hint vertex to find where it goes
+		unsigned int Insert( double X, double Y, unsigned int HintVertex )
+		{
+			int start = m_lastTriangle;
+			if ( HintVertex < m_xs.size() && m_vertexTriangles[ HintVertex ] >= 0 ) start = m_vertexTriangles[ HintVertex ];
+
+			//Exactly coincident points would make zero-area triangles, so nudge the copy in the triangulation
+			int triangle = this->Locate( X, Y, start );
+			while ( this->CoincidesWithVertex( triangle, X, Y ) )
+			{
+				X += ( fabs( X ) + 1.0 ) * 1E-12;
+				triangle = this->Locate( X, Y, triangle );
+			}
+			unsigned int const vertex = this->AddVertex( X, Y );
+
+			//Check for the point lying on an edge
+			Triangle const& found = m_triangles[ triangle ];
+			int onEdge = -1;
+			for ( unsigned int edge = 0; edge < 3; edge++ )
+			{
+				if ( this->Orientation( found.vertices[ ( edge + 1 ) % 3 ], found.vertices[ ( edge + 2 ) % 3 ], vertex ) == 0.0 ) onEdge = edge;
+			}
+
+			m_legaliseStack.clear();
+			if ( onEdge >= 0 ) this->SplitEdge( triangle, onEdge, vertex );
+			else this->SplitTriangle( triangle, vertex );
+			this->Legalise();
+
+			return vertex;
+		}
+
+		//Take a point out and fill the hole it leaves
+		void Remove( unsigned int Vertex )
+		{
+			//Gather the ring of neighbours anticlockwise, with the triangles outside each ring edge
+			m_ring.clear();
+			m_ringOuter.clear();
+			m_oldTriangles.clear();
+			int const firstTriangle = m_vertexTriangles[ Vertex ];
+			int triangle = firstTriangle;
+			do
+			{
+				Triangle const& current = m_triangles[ triangle ];
+				unsigned int const index = this->IndexOf( triangle, Vertex );
+				m_ring.push_back( current.vertices[ ( index + 1 ) % 3 ] );
+				m_ringOuter.push_back( current.neighbours[ index ] );
+				m_oldTriangles.push_back( triangle );
+				triangle = current.neighbours[ ( index + 1 ) % 3 ];
+			}
+			while ( triangle != firstTriangle );
+
+			//Clip ears until only a triangle is left
+			while ( m_ring.size() > 3 )
+			{
+				unsigned int const ringSize = m_ring.size();
+				unsigned int const ear = this->FindEar();
+				unsigned int const before = ( ear + ringSize - 1 ) % ringSize;
+				unsigned int const after = ( ear + 1 ) % ringSize;
+
+				int const newTriangle = this->AddTriangle( m_ring[ before ], m_ring[ ear ], m_ring[ after ], m_ringOuter[ ear ], -1, m_ringOuter[ before ] );
+				this->LinkAcross( m_ringOuter[ ear ], m_ring[ ear ], m_ring[ after ], newTriangle );
+				this->LinkAcross( m_ringOuter[ before ], m_ring[ before ], m_ring[ ear ], newTriangle );
+
+				//The new chord replaces two ring edges
+				m_ringOuter[ before ] = newTriangle;
+				m_ring.erase( m_ring.begin() + ear );
+				m_ringOuter.erase( m_ringOuter.begin() + ear );
+			}
+			int const lastTriangle = this->AddTriangle( m_ring[ 0 ], m_ring[ 1 ], m_ring[ 2 ], m_ringOuter[ 1 ], m_ringOuter[ 2 ], m_ringOuter[ 0 ] );
+			this->LinkAcross( m_ringOuter[ 0 ], m_ring[ 0 ], m_ring[ 1 ], lastTriangle );
+			this->LinkAcross( m_ringOuter[ 1 ], m_ring[ 1 ], m_ring[ 2 ], lastTriangle );
+			this->LinkAcross( m_ringOuter[ 2 ], m_ring[ 2 ], m_ring[ 0 ], lastTriangle );
+
+			//Recycle the storage
+			for ( unsigned int oldIndex = 0; oldIndex < m_oldTriangles.size(); oldIndex++ )
+			{
+				m_triangles[ m_oldTriangles[ oldIndex ] ].alive = false;
+				m_freeTriangles.push_back( m_oldTriangles[ oldIndex ] );
+			}
+			m_vertexTriangles[ Vertex ] = -1;
+			m_freeVertices.push_back( Vertex );
+		}
+
+		//Call a function for every vertex joined to this one by an edge
+		template< class Function > void ForEachNeighbour( unsigned int Vertex, Function F ) const
+		{
+			int const firstTriangle = m_vertexTriangles[ Vertex ];
+			int triangle = firstTriangle;
+			do
+			{
+				Triangle const& current = m_triangles[ triangle ];
+				unsigned int const index = this->IndexOf( triangle, Vertex );
+				F( current.vertices[ ( index + 1 ) % 3 ] );
+				triangle = current.neighbours[ ( index + 1 ) % 3 ];
+			}
+			while ( triangle != firstTriangle );
+		}
+
+	private:
+		//Vertices anticlockwise, neighbours[ i ] is across the edge opposite vertices[ i ]
+		struct Triangle
+		{
+			unsigned int vertices[ 3 ];
+			int neighbours[ 3 ];
+			bool alive;
+		};
+
+		std::vector< double > m_xs, m_ys;
+		std::vector< int > m_vertexTriangles;
+		std::vector< unsigned int > m_freeVertices;
+		std::vector< Triangle > m_triangles;
+		std::vector< int > m_freeTriangles;
+		int m_lastTriangle = 0;
+
+		//Scratch space, kept to avoid allocating on every update
+		std::vector< int > m_legaliseStack;
+		std::vector< unsigned int > m_ring;
+		std::vector< int > m_ringOuter;
+		std::vector< int > m_oldTriangles;
+
+		//Positive if A, B, C are anticlockwise
+		double Orientation( unsigned int A, unsigned int B, unsigned int C ) const
+		{
+			return ( ( m_xs[ B ] - m_xs[ A ] ) * ( m_ys[ C ] - m_ys[ A ] ) ) - ( ( m_ys[ B ] - m_ys[ A ] ) * ( m_xs[ C ] - m_xs[ A ] ) );
+		}
+		double Orientation( unsigned int A, unsigned int B, double X, double Y ) const
+		{
+			return ( ( m_xs[ B ] - m_xs[ A ] ) * ( Y - m_ys[ A ] ) ) - ( ( m_ys[ B ] - m_ys[ A ] ) * ( X - m_xs[ A ] ) );
+		}
+
+		//Positive if D is inside the circumcircle of anticlockwise A, B, C
+		double InCircle( unsigned int A, unsigned int B, unsigned int C, unsigned int D ) const
+		{
+			double const adx = m_xs[ A ] - m_xs[ D ];
+			double const ady = m_ys[ A ] - m_ys[ D ];
+			double const bdx = m_xs[ B ] - m_xs[ D ];
+			double const bdy = m_ys[ B ] - m_ys[ D ];
+			double const cdx = m_xs[ C ] - m_xs[ D ];
+			double const cdy = m_ys[ C ] - m_ys[ D ];
+			double const ad2 = ( adx * adx ) + ( ady * ady );
+			double const bd2 = ( bdx * bdx ) + ( bdy * bdy );
+			double const cd2 = ( cdx * cdx ) + ( cdy * cdy );
+			return ( adx * ( ( bdy * cd2 ) - ( bd2 * cdy ) ) )
+				- ( ady * ( ( bdx * cd2 ) - ( bd2 * cdx ) ) )
+				+ ( ad2 * ( ( bdx * cdy ) - ( bdy * cdx ) ) );
+		}
+
+		unsigned int AddVertex( double X, double Y )
+		{
+			if ( !m_freeVertices.empty() )
+			{
+				unsigned int const vertex = m_freeVertices.back();
+				m_freeVertices.pop_back();
+				m_xs[ vertex ] = X;
+				m_ys[ vertex ] = Y;
+				return vertex;
+			}
+			m_xs.push_back( X );
+			m_ys.push_back( Y );
+			m_vertexTriangles.push_back( -1 );
+			return m_xs.size() - 1;
+		}
+
+		//Make a triangle and point its vertices at it
+		int AddTriangle( unsigned int A, unsigned int B, unsigned int C, int OppositeA, int OppositeB, int OppositeC )
+		{
+			int triangle;
+			if ( !m_freeTriangles.empty() )
+			{
+				triangle = m_freeTriangles.back();
+				m_freeTriangles.pop_back();
+			}
+			else
+			{
+				triangle = m_triangles.size();
+				m_triangles.push_back( Triangle() );
+			}
+			this->SetTriangle( triangle, A, B, C, OppositeA, OppositeB, OppositeC );
+			return triangle;
+		}
+		void SetTriangle( int TriangleIndex, unsigned int A, unsigned int B, unsigned int C, int OppositeA, int OppositeB, int OppositeC )
+		{
+			Triangle & triangle = m_triangles[ TriangleIndex ];
+			triangle.vertices[ 0 ] = A;
+			triangle.vertices[ 1 ] = B;
+			triangle.vertices[ 2 ] = C;
+			triangle.neighbours[ 0 ] = OppositeA;
+			triangle.neighbours[ 1 ] = OppositeB;
+			triangle.neighbours[ 2 ] = OppositeC;
+			triangle.alive = true;
+			m_vertexTriangles[ A ] = m_vertexTriangles[ B ] = m_vertexTriangles[ C ] = TriangleIndex;
+			m_lastTriangle = TriangleIndex;
+		}
+
+		unsigned int IndexOf( int TriangleIndex, unsigned int Vertex ) const
+		{
+			Triangle const& triangle = m_triangles[ TriangleIndex ];
+			if ( triangle.vertices[ 0 ] == Vertex ) return 0;
+			if ( triangle.vertices[ 1 ] == Vertex ) return 1;
+			return 2;
+		}
+
+		//Point the edge A-B of an outside triangle back at a new triangle
+		void LinkAcross( int Outer, unsigned int A, unsigned int B, int NewTriangle )
+		{
+			if ( Outer < 0 ) return;
+			Triangle & outer = m_triangles[ Outer ];
+			for ( unsigned int index = 0; index < 3; index++ )
+			{
+				if ( outer.vertices[ index ] != A && outer.vertices[ index ] != B )
+				{
+					outer.neighbours[ index ] = NewTriangle;
+					return;
+				}
+			}
+		}
+
+		bool CoincidesWithVertex( int TriangleIndex, double X, double Y ) const
+		{
+			Triangle const& triangle = m_triangles[ TriangleIndex ];
+			for ( unsigned int index = 0; index < 3; index++ )
+			{
+				unsigned int const vertex = triangle.vertices[ index ];
+				if ( m_xs[ vertex ] == X && m_ys[ vertex ] == Y ) return true;
+			}
+			return false;
+		}
+
+		//Walk across edges towards the point, rotating the first edge tried so the walk can't cycle
+		int Locate( double X, double Y, int Start ) const
+		{
+			int triangle = Start;
+			for ( unsigned int step = 0; step < m_triangles.size(); step++ )
+			{
+				Triangle const& current = m_triangles[ triangle ];
+				int next = -1;
+				for ( unsigned int edgeStep = 0; edgeStep < 3; edgeStep++ )
+				{
+					unsigned int const edge = ( edgeStep + step ) % 3;
+					if ( this->Orientation( current.vertices[ ( edge + 1 ) % 3 ], current.vertices[ ( edge + 2 ) % 3 ], X, Y ) < 0.0 )
+					{
+						next = current.neighbours[ edge ];
+						break;
+					}
+				}
+				if ( next < 0 ) return triangle;
+				triangle = next;
+			}
+
+			//Walk failed on rounding, so check everything
+			for ( unsigned int triangleIndex = 0; triangleIndex < m_triangles.size(); triangleIndex++ )
+			{
+				Triangle const& current = m_triangles[ triangleIndex ];
+				if ( !current.alive ) continue;
+				if ( this->Orientation( current.vertices[ 1 ], current.vertices[ 2 ], X, Y ) >= 0.0 &&
+						this->Orientation( current.vertices[ 2 ], current.vertices[ 0 ], X, Y ) >= 0.0 &&
+						this->Orientation( current.vertices[ 0 ], current.vertices[ 1 ], X, Y ) >= 0.0 ) return triangleIndex;
+			}
+			return triangle;
+		}
+
+		//Point strictly inside: one triangle becomes three
+		void SplitTriangle( int TriangleIndex, unsigned int Vertex )
+		{
+			Triangle const old = m_triangles[ TriangleIndex ];
+			unsigned int const v0 = old.vertices[ 0 ];
+			unsigned int const v1 = old.vertices[ 1 ];
+			unsigned int const v2 = old.vertices[ 2 ];
+			int const t0 = TriangleIndex;
+			int const t1 = this->AddTriangle( Vertex, v2, v0, old.neighbours[ 1 ], -1, -1 );
+			int const t2 = this->AddTriangle( Vertex, v0, v1, old.neighbours[ 2 ], -1, -1 );
+			m_triangles[ t1 ].neighbours[ 1 ] = t2;
+			m_triangles[ t1 ].neighbours[ 2 ] = t0;
+			m_triangles[ t2 ].neighbours[ 1 ] = t0;
+			m_triangles[ t2 ].neighbours[ 2 ] = t1;
+			this->SetTriangle( t0, Vertex, v1, v2, old.neighbours[ 0 ], t1, t2 );
+			this->LinkAcross( old.neighbours[ 1 ], v2, v0, t1 );
+			this->LinkAcross( old.neighbours[ 2 ], v0, v1, t2 );
+			m_vertexTriangles[ v0 ] = t1;
+
+			m_legaliseStack.push_back( t0 );
+			m_legaliseStack.push_back( t1 );
+			m_legaliseStack.push_back( t2 );
+		}
+
+		//Point on an edge: the two triangles sharing it become four
+		void SplitEdge( int TriangleIndex, unsigned int Edge, unsigned int Vertex )
+		{
+			Triangle const oldT = m_triangles[ TriangleIndex ];
+			unsigned int const c = oldT.vertices[ Edge ];
+			unsigned int const a = oldT.vertices[ ( Edge + 1 ) % 3 ];
+			unsigned int const b = oldT.vertices[ ( Edge + 2 ) % 3 ];
+			int const otherIndex = oldT.neighbours[ Edge ];
+			Triangle const oldU = m_triangles[ otherIndex ];
+			unsigned int const f = this->IndexOf( otherIndex, b ) + 2;
+			unsigned int const d = oldU.vertices[ f % 3 ];
+
+			int const tA = TriangleIndex;
+			int const tC = otherIndex;
+			int const tB = this->AddTriangle( Vertex, c, a, oldT.neighbours[ ( Edge + 2 ) % 3 ], -1, -1 );
+			int const tD = this->AddTriangle( Vertex, d, b, oldU.neighbours[ ( f + 2 ) % 3 ], -1, -1 );
+			this->SetTriangle( tA, Vertex, b, c, oldT.neighbours[ ( Edge + 1 ) % 3 ], tB, tD );
+			this->SetTriangle( tC, Vertex, a, d, oldU.neighbours[ ( f + 1 ) % 3 ], tD, tB );
+			m_triangles[ tB ].neighbours[ 1 ] = tC;
+			m_triangles[ tB ].neighbours[ 2 ] = tA;
+			m_triangles[ tD ].neighbours[ 1 ] = tA;
+			m_triangles[ tD ].neighbours[ 2 ] = tC;
+			this->LinkAcross( oldT.neighbours[ ( Edge + 2 ) % 3 ], c, a, tB );
+			this->LinkAcross( oldU.neighbours[ ( f + 2 ) % 3 ], d, b, tD );
+
+			m_legaliseStack.push_back( tA );
+			m_legaliseStack.push_back( tB );
+			m_legaliseStack.push_back( tC );
+			m_legaliseStack.push_back( tD );
+		}
+
+		//Flip edges opposite the new point until all are Delaunay
+		//Every triangle on the stack has the new point as vertex 0
+		void Legalise()
+		{
+			while ( !m_legaliseStack.empty() )
+			{
+				int const t = m_legaliseStack.back();
+				m_legaliseStack.pop_back();
+
+				Triangle const oldT = m_triangles[ t ];
+				int const u = oldT.neighbours[ 0 ];
+				if ( u < 0 ) continue;
+
+				unsigned int const p = oldT.vertices[ 0 ];
+				unsigned int const a = oldT.vertices[ 1 ];
+				unsigned int const b = oldT.vertices[ 2 ];
+				Triangle const oldU = m_triangles[ u ];
+				unsigned int const j = ( this->IndexOf( u, b ) + 2 ) % 3;
+				unsigned int const q = oldU.vertices[ j ];
+
+				if ( this->InCircle( p, a, b, q ) <= 0.0 ) continue;
+
+				//Only flip a convex quadrilateral, rounding can claim otherwise
+				if ( this->Orientation( p, a, q ) <= 0.0 || this->Orientation( p, q, b ) <= 0.0 ) continue;
+
+				int const outsideAQ = oldU.neighbours[ ( j + 1 ) % 3 ];
+				int const outsideQB = oldU.neighbours[ ( j + 2 ) % 3 ];
+				this->SetTriangle( u, p, q, b, outsideQB, oldT.neighbours[ 1 ], t );
+				this->SetTriangle( t, p, a, q, outsideAQ, u, oldT.neighbours[ 2 ] );
+				this->LinkAcross( outsideAQ, a, q, t );
+				this->LinkAcross( oldT.neighbours[ 1 ], b, p, u );
+
+				m_legaliseStack.push_back( t );
+				m_legaliseStack.push_back( u );
+			}
+		}
+
+		//An ear is Delaunay if it is convex and no other ring vertex is in its circumcircle
+		//If rounding rules them all out, take a convex ear with no ring vertex inside it
+		unsigned int FindEar() const
+		{
+			unsigned int const ringSize = m_ring.size();
+			int fallback = -1;
+			for ( unsigned int ear = 0; ear < ringSize; ear++ )
+			{
+				unsigned int const a = m_ring[ ( ear + ringSize - 1 ) % ringSize ];
+				unsigned int const b = m_ring[ ear ];
+				unsigned int const c = m_ring[ ( ear + 1 ) % ringSize ];
+				if ( this->Orientation( a, b, c ) <= 0.0 ) continue;
+
+				bool isDelaunay = true;
+				bool isEmpty = true;
+				for ( unsigned int other = 2; other < ringSize - 1; other++ )
+				{
+					unsigned int const d = m_ring[ ( ear + other ) % ringSize ];
+					if ( this->InCircle( a, b, c, d ) > 0.0 )
+					{
+						isDelaunay = false;
+						if ( this->Orientation( a, b, d ) >= 0.0 && this->Orientation( b, c, d ) >= 0.0 && this->Orientation( c, a, d ) >= 0.0 ) isEmpty = false;
+					}
+				}
+				if ( isDelaunay ) return ear;
+				if ( isEmpty && fallback < 0 ) fallback = ear;
+			}
+			return ( fallback < 0 ) ? 0 : fallback;
+		}
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef INDEXED_MIN_HEAP_H
+#define INDEXED_MIN_HEAP_H
+
+#include <vector>
+
+//Binary min-heap of object indices keyed by a double, with key updates and removal
+//Equal keys are ordered by index, so the result matches a linear scan taking the first minimum
+class IndexedMinHeap
+{
+	public:
+		IndexedMinHeap( unsigned int Capacity ) : m_keys( Capacity ), m_positions( Capacity, -1 )
+		{
+			m_heap.reserve( Capacity );
+		}
+
+		bool Empty() const
+		{
+			return m_heap.empty();
+		}
+		unsigned int Top() const
+		{
+			return m_heap[ 0 ];
+		}
+		double TopKey() const
+		{
+			return m_keys[ m_heap[ 0 ] ];
+		}
+
+		//Insert or change the key of an index
+		void Set( unsigned int Index, double Key )
+		{
+			if ( m_positions[ Index ] < 0 )
+			{
+				m_keys[ Index ] = Key;
+				m_positions[ Index ] = m_heap.size();
+				m_heap.push_back( Index );
+				this->SiftUp( m_heap.size() - 1 );
+				return;
+			}
+			double const oldKey = m_keys[ Index ];
+			m_keys[ Index ] = Key;
+			if ( Key < oldKey ) this->SiftUp( m_positions[ Index ] );
+			else this->SiftDown( m_positions[ Index ] );
+		}
+
+		void Remove( unsigned int Index )
+		{
+			int const position = m_positions[ Index ];
+			if ( position < 0 ) return;
+			m_positions[ Index ] = -1;
+			unsigned int const last = m_heap.back();
+			m_heap.pop_back();
+			if ( position == int( m_heap.size() ) ) return;
+			m_heap[ position ] = last;
+			m_positions[ last ] = position;
+			this->SiftUp( position );
+			this->SiftDown( m_positions[ last ] );
+		}
+
+	private:
+		std::vector< double > m_keys;
+		std::vector< int > m_positions;
+		std::vector< unsigned int > m_heap;
+
+		bool Less( unsigned int A, unsigned int B ) const
+		{
+			return ( m_keys[ A ] < m_keys[ B ] || ( m_keys[ A ] == m_keys[ B ] && A < B ) );
+		}
+
+		void Place( unsigned int Position, unsigned int Index )
+		{
+			m_heap[ Position ] = Index;
+			m_positions[ Index ] = Position;
+		}
+
+		void SiftUp( unsigned int Position )
+		{
+			unsigned int const index = m_heap[ Position ];
+			while ( Position > 0 )
+			{
+				unsigned int const parent = ( Position - 1 ) / 2;
+				if ( !this->Less( index, m_heap[ parent ] ) ) break;
+				this->Place( Position, m_heap[ parent ] );
+				Position = parent;
+			}
+			this->Place( Position, index );
+		}
+
+		void SiftDown( unsigned int Position )
+		{
+			unsigned int const index = m_heap[ Position ];
+			unsigned int const size = m_heap.size();
+			while ( true )
+			{
+				unsigned int child = ( 2 * Position ) + 1;
+				if ( child >= size ) break;
+				if ( child + 1 < size && this->Less( m_heap[ child + 1 ], m_heap[ child ] ) ) child++;
+				if ( !this->Less( m_heap[ child ], index ) ) break;
+				this->Place( Position, m_heap[ child ] );
+				Position = child;
+			}
+			this->Place( Position, index );
+		}
+};
+
+#endif
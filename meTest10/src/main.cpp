@@ -0,0 +1,315 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <map>
+
+#include "tbb/tick_count.h"
+
+#include "TLorentzVector.h"
+
+#include "DelaunayTriangulation.h"
+#include "IndexedMinHeap.h"
+
+using namespace std;
+using namespace tbb;
+
+bool SortJetsByPt( TLorentzVector const& i, TLorentzVector const& j )
+{
+	return ( i.Pt() > j.Pt() );
+}
+
+//Try to make some jets myself
+int main( int argc, char * argv[] )
+{
+	vector< TLorentzVector > inputs, outputs;
+
+	//Dummy TLV for conversions
+	TLorentzVector dummy1;
+
+	//Read the fastjet example input into TLVs
+	double px, py, pz, E;
+	while ( cin >> px >> py >> pz >> E )
+	{
+		inputs.push_back( TLorentzVector( px, py, pz, E ) );
+	}
+
+	//Sorting the input pT high to low gives a large speedup
+	sort( inputs.begin(), inputs.end(), SortJetsByPt );
+
+	//kt^2n = pt^2n //for single objects
+	//kt^2n = min( pt^2n ) x delta_R^2 / D^2 //for pairs
+	//The smallest pair kt^2 is always between geometric nearest neighbours,
+	//and the nearest neighbour of a point is always joined to it in the Delaunay triangulation
+	//Just do akt 0.6
+	double const D = 0.6;
+	double const aD2 = 1.0 / ( D * D );
+	double const TWO_PI = 2.0 * M_PI;
+
+	//Copy input data into flat arrays on the heap, big events don't fit on the stack
+	unsigned int const totalObjects = inputs.size();
+	vector< double > phis( totalObjects );
+	vector< double > rapidities( totalObjects );
+	vector< double > pts( totalObjects );
+	vector< double > apt2s( totalObjects );
+	vector< double > energies( totalObjects );
+	vector< double > pxs( totalObjects );
+	vector< double > pys( totalObjects );
+	vector< double > pzs( totalObjects );
+	vector< double > nearestDeltaR2s( totalObjects, DBL_MAX );
+	vector< unsigned int > nearestNeighbours( totalObjects );
+	vector< bool > wasDeleted( totalObjects, false );
+	double minRapidity = 0.0;
+	double maxRapidity = 0.0;
+	for ( unsigned int i = 0; i < totalObjects; i++ )
+	{
+		TLorentzVector const& dummy = inputs[ i ];
+		phis[ i ] = dummy.Phi();
+		if ( phis[ i ] < 0.0 ) phis[ i ] += TWO_PI;
+		rapidities[ i ] =  dummy.Rapidity();
+		pts[ i ] = dummy.Pt();
+		apt2s[ i ] = 1.0 / ( pts[ i ] * pts[ i ] );
+		pxs[ i ] = dummy.Px();
+		pys[ i ] = dummy.Py();
+		pzs[ i ] = dummy.Pz();
+		energies[ i ] = dummy.E();
+		nearestNeighbours[ i ] = i;
+		minRapidity = min( minRapidity, rapidities[ i ] );
+		maxRapidity = max( maxRapidity, rapidities[ i ] );
+	}
+
+	//Phi is periodic: objects within D of the edges get a copy on the other side,
+	//so any pair closer than D is also close in the plane
+	DelaunayTriangulation triangulation( minRapidity, maxRapidity, -D, TWO_PI + D );
+	vector< unsigned int > primaryVertices( totalObjects );
+	vector< int > lowerCopyVertices( totalObjects, -1 );
+	vector< int > upperCopyVertices( totalObjects, -1 );
+	vector< unsigned int > vertexObjects;
+
+	auto insertObject = [&]( unsigned int objectIndex, unsigned int hintVertex )
+	{
+		auto addVertex = [&]( double phi ) -> unsigned int
+		{
+			unsigned int const vertex = triangulation.Insert( rapidities[ objectIndex ], phi, hintVertex );
+			if ( vertex >= vertexObjects.size() ) vertexObjects.resize( vertex + 1 );
+			vertexObjects[ vertex ] = objectIndex;
+			return vertex;
+		};
+		double const phi = phis[ objectIndex ];
+		primaryVertices[ objectIndex ] = addVertex( phi );
+		lowerCopyVertices[ objectIndex ] = ( phi > TWO_PI - D ) ? int( addVertex( phi - TWO_PI ) ) : -1;
+		upperCopyVertices[ objectIndex ] = ( phi < D ) ? int( addVertex( phi + TWO_PI ) ) : -1;
+	};
+	auto removeObject = [&]( unsigned int objectIndex )
+	{
+		triangulation.Remove( primaryVertices[ objectIndex ] );
+		if ( lowerCopyVertices[ objectIndex ] >= 0 ) triangulation.Remove( lowerCopyVertices[ objectIndex ] );
+		if ( upperCopyVertices[ objectIndex ] >= 0 ) triangulation.Remove( upperCopyVertices[ objectIndex ] );
+	};
+
+	//Call a function for every object next to any of the vertices of an object
+	auto forEachAdjacentObject = [&]( unsigned int objectIndex, auto function )
+	{
+		auto visit = [&]( unsigned int vertex )
+		{
+			if ( !triangulation.IsSuperVertex( vertex ) ) function( vertexObjects[ vertex ] );
+		};
+		triangulation.ForEachNeighbour( primaryVertices[ objectIndex ], visit );
+		if ( lowerCopyVertices[ objectIndex ] >= 0 ) triangulation.ForEachNeighbour( lowerCopyVertices[ objectIndex ], visit );
+		if ( upperCopyVertices[ objectIndex ] >= 0 ) triangulation.ForEachNeighbour( upperCopyVertices[ objectIndex ], visit );
+	};
+
+	//The min kt^2 for every object, ordered so the smallest is always on top
+	IndexedMinHeap minKts( totalObjects );
+	auto updateKt2 = [&]( unsigned int thisObjectIndex )
+	{
+		unsigned int const neighbour = nearestNeighbours[ thisObjectIndex ];
+		double const thisApt2 = apt2s[ thisObjectIndex ];
+		double kt2 = thisApt2;
+		if ( neighbour != thisObjectIndex )
+		{
+			kt2 = min( kt2, nearestDeltaR2s[ thisObjectIndex ] * aD2 * min( thisApt2, apt2s[ neighbour ] ) );
+		}
+		minKts.Set( thisObjectIndex, kt2 );
+	};
+
+	//The nearest neighbour is one of the vertices joined to the primary vertex
+	auto findNeighbour = [&]( unsigned int thisObjectIndex )
+	{
+		unsigned int const thisVertex = primaryVertices[ thisObjectIndex ];
+		double minDeltaR2 = DBL_MAX;
+		unsigned int minDeltaR2Pair = thisObjectIndex;
+		triangulation.ForEachNeighbour( thisVertex, [&]( unsigned int pairVertex )
+		{
+			if ( triangulation.IsSuperVertex( pairVertex ) ) return;
+			unsigned int const pairObjectIndex = vertexObjects[ pairVertex ];
+			if ( pairObjectIndex == thisObjectIndex ) return;
+
+			//Use the real coordinates rather than the triangulation's in case a point was nudged
+			double deltaPhi = phis[ thisObjectIndex ] - phis[ pairObjectIndex ];
+			if ( deltaPhi > M_PI ) deltaPhi -= TWO_PI;
+			if ( deltaPhi < -M_PI ) deltaPhi += TWO_PI;
+			double const deltaRapidity = rapidities[ thisObjectIndex ] - rapidities[ pairObjectIndex ];
+			double const pairDeltaR2 = ( deltaPhi * deltaPhi ) + ( deltaRapidity * deltaRapidity );
+
+			//Find minimum, lowest index wins a tie
+			if ( pairDeltaR2 < minDeltaR2 || ( pairDeltaR2 == minDeltaR2 && pairObjectIndex < minDeltaR2Pair ) )
+			{
+				minDeltaR2 = pairDeltaR2;
+				minDeltaR2Pair = pairObjectIndex;
+			}
+		} );
+
+		nearestDeltaR2s[ thisObjectIndex ] = minDeltaR2;
+		nearestNeighbours[ thisObjectIndex ] = minDeltaR2Pair;
+		updateKt2( thisObjectIndex );
+	};
+
+	//Make the jets
+	tick_count const startTime = tick_count::now();
+	tick_count::interval_t triangulationTime;
+	tick_count::interval_t findMinKtTime;
+	tick_count::interval_t updateCollectionsTime;
+
+	//Insert in a snaking walk over a coarse grid, so each insertion starts its search nearby
+	tick_count const startTriangulationTime = tick_count::now();
+	vector< unsigned int > insertOrder( totalObjects );
+	vector< unsigned int > insertCells( totalObjects );
+	for ( unsigned int i = 0; i < totalObjects; i++ )
+	{
+		unsigned int const rapidityCell = ( unsigned int )( ( rapidities[ i ] - minRapidity ) / D );
+		unsigned int phiCell = ( unsigned int )( phis[ i ] / D );
+		if ( rapidityCell % 2 ) phiCell = 1000 - phiCell;
+		insertOrder[ i ] = i;
+		insertCells[ i ] = ( rapidityCell * 1024 ) + phiCell;
+	}
+	sort( insertOrder.begin(), insertOrder.end(), [&]( unsigned int i, unsigned int j ) { return insertCells[ i ] < insertCells[ j ]; } );
+	unsigned int hintVertex = 0;
+	for ( unsigned int orderIndex = 0; orderIndex < totalObjects; orderIndex++ )
+	{
+		insertObject( insertOrder[ orderIndex ], hintVertex );
+		hintVertex = primaryVertices[ insertOrder[ orderIndex ] ];
+	}
+	for ( unsigned int i = 0; i < totalObjects; i++ ) findNeighbour( i );
+	triangulationTime += tick_count::now() - startTriangulationTime;
+
+	//Objects whose neighbour may have changed, with a stamp to avoid repeats
+	vector< unsigned int > affected;
+	vector< unsigned int > affectedStamps( totalObjects, 0 );
+	unsigned int stamp = 0;
+	auto markAffected = [&]( unsigned int objectIndex )
+	{
+		if ( affectedStamps[ objectIndex ] == stamp ) return;
+		affectedStamps[ objectIndex ] = stamp;
+		affected.push_back( objectIndex );
+	};
+
+	while( !minKts.Empty() )
+	{
+		//Find min kt^2 value over all objects
+		tick_count const startKtTime = tick_count::now();
+		unsigned int const thisMinIndex = minKts.Top();
+		double const overallMinKt2 = minKts.TopKey();
+
+		//Beam distance wins if it is no larger than the pair distance
+		unsigned int pairMinIndex = nearestNeighbours[ thisMinIndex ];
+		if ( overallMinKt2 == apt2s[ thisMinIndex ] ) pairMinIndex = thisMinIndex;
+		findMinKtTime += tick_count::now() - startKtTime;
+
+		//Single objects as min kt are outputs, pairs get merged
+		tick_count const startUpdateTime = tick_count::now();
+		bool const isMerge = ( thisMinIndex != pairMinIndex );
+
+		//Anything that had a removed object as its nearest neighbour has to look again
+		stamp++;
+		affected.clear();
+		auto markIfLost = [&]( unsigned int objectIndex )
+		{
+			unsigned int const neighbour = nearestNeighbours[ objectIndex ];
+			if ( neighbour == thisMinIndex || neighbour == pairMinIndex ) markAffected( objectIndex );
+		};
+		forEachAdjacentObject( thisMinIndex, markIfLost );
+		if ( isMerge ) forEachAdjacentObject( pairMinIndex, markIfLost );
+
+		//Somewhere nearby to start looking for where the merged object goes
+		hintVertex = 0;
+		triangulation.ForEachNeighbour( primaryVertices[ thisMinIndex ], [&]( unsigned int vertex )
+		{
+			if ( !triangulation.IsSuperVertex( vertex ) && vertexObjects[ vertex ] != pairMinIndex ) hintVertex = vertex;
+		} );
+
+		removeObject( thisMinIndex );
+		if ( !isMerge )
+		{
+			//Make output TLV
+			outputs.push_back( TLorentzVector( pxs[ thisMinIndex ], pys[ thisMinIndex ], pzs[ thisMinIndex ], energies[ thisMinIndex ] ) );
+
+			//Remove jet from active data
+			wasDeleted[ thisMinIndex ] = true;
+			minKts.Remove( thisMinIndex );
+		}
+		else
+		{
+			//Merge the pair
+			double const newPx = pxs[ thisMinIndex ] + pxs[ pairMinIndex ];
+			double const newPy = pys[ thisMinIndex ] + pys[ pairMinIndex ];
+			double const newPz = pzs[ thisMinIndex ] + pzs[ pairMinIndex ];
+			double const newE = energies[ thisMinIndex ] + energies[ pairMinIndex ];
+
+			//Remove the pair object
+			removeObject( pairMinIndex );
+			wasDeleted[ pairMinIndex ] = true;
+			minKts.Remove( pairMinIndex );
+
+			//Replace the original object with the merge
+			dummy1.SetPxPyPzE( newPx, newPy, newPz, newE ); //for convenience
+			pts[ thisMinIndex ] = dummy1.Pt();
+			apt2s[ thisMinIndex ] = 1.0 / ( pts[ thisMinIndex ] * pts[ thisMinIndex ] );
+			pxs[ thisMinIndex ] = newPx;
+			pys[ thisMinIndex ] = newPy;
+			pzs[ thisMinIndex ] = newPz;
+			rapidities[ thisMinIndex ] = dummy1.Rapidity();
+			phis[ thisMinIndex ] = dummy1.Phi();
+			if ( phis[ thisMinIndex ] < 0.0 ) phis[ thisMinIndex ] += TWO_PI;
+			energies[ thisMinIndex ] = newE;
+			insertObject( thisMinIndex, hintVertex );
+
+			//Only the new object's neighbours can have it as their nearest
+			markAffected( thisMinIndex );
+			forEachAdjacentObject( thisMinIndex, markAffected );
+		}
+
+		for ( unsigned int affectedIndex = 0; affectedIndex < affected.size(); affectedIndex++ )
+		{
+			unsigned int const objectIndex = affected[ affectedIndex ];
+			if ( !wasDeleted[ objectIndex ] ) findNeighbour( objectIndex );
+		}
+		updateCollectionsTime += tick_count::now() - startUpdateTime;
+	}
+	cout << "Total time: " << ( tick_count::now() - startTime ).seconds() << " sec" << endl;
+	cout << "Triangulation time: " << triangulationTime.seconds() << " sec" << endl;
+	cout << "Kt finding time: " << findMinKtTime.seconds() << " sec" << endl;
+	cout << "Collection update time: " << updateCollectionsTime.seconds() << " sec" << endl;
+
+	sort( outputs.begin(), outputs.end(), SortJetsByPt );
+
+	//Output exactly like fastjet demo
+	printf("%5s %15s %15s %15s\n","jet #", "rapidity", "phi", "pt");
+	for ( unsigned int jetIndex = 0; jetIndex < outputs.size(); jetIndex++ )
+	{
+		//if ( outputs[ jetIndex ].Pt() < 5.0 ) break;
+		double phi = outputs[ jetIndex ].Phi();
+		while ( phi < 0.0 ) phi += TWO_PI;
+		printf( "%5u %15.8f %15.8f %15.8f\n",
+				jetIndex,
+				outputs[ jetIndex ].Rapidity(),
+				phi,
+				outputs[ jetIndex ].Pt() );
+	}
+
+	return 0;
+}
@@ -0,0 +1,268 @@
+#ifndef BINARY_EVENT_FILE_H
+#define BINARY_EVENT_FILE_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "FourMomentum.h"
+#include "ParticleArrays.h"
+#include "KinematicsKernels.h"
+
+//Binary event file, native byte order:
+//  64 byte header: magic, version, flags, number of events, offset of the index
+//  per event, 64 byte aligned: px[], py[], pz[], E[], and if KINEMATICS is set perp2[], rapidity[], phi[],
+//    each column padded to 64 bytes
+//  index at the end: offset and particle count of every event
+//Particles in each event are stored sorted pT high to low, ready to cluster.
+//The kinematics columns come from a kinematics kernel, and APPROXIMATE_KINEMATICS says whether it was
+//one of the approximations, which all give the same numbers, or libm (exact). The clusterer only uses
+//them when its own kernel is of the same kind, so they give the same numbers as working them out.
+//Files written before the flag have libm columns, which is what its absence means.
+struct BinaryEventHeader
+{
+	static uint64_t const MAGIC = 0x5645544a4e454231ULL; //"1BENJETV"
+	static uint32_t const VERSION = 1;
+	static uint32_t const KINEMATICS = 1;
+	static uint32_t const APPROXIMATE_KINEMATICS = 2;
+	static size_t const ALIGNMENT = 64;
+
+	uint64_t magic;
+	uint32_t version;
+	uint32_t flags;
+	uint64_t events;
+	uint64_t indexOffset;
+	char padding[ 32 ];
+};
+
+struct BinaryEventIndexEntry
+{
+	uint64_t offset;
+	uint64_t particles;
+};
+
+inline uint64_t BinaryColumnSize( uint64_t Particles )
+{
+	return ( ( ( Particles * sizeof( double ) ) + BinaryEventHeader::ALIGNMENT - 1 ) / BinaryEventHeader::ALIGNMENT ) * BinaryEventHeader::ALIGNMENT;
+}
+
+//Writes events one at a time, the index goes on the end when it is closed
+class BinaryEventWriter
+{
+	public:
+		//The kinematics columns, if wanted, are worked out with Kinematics
+		BinaryEventWriter( std::string const& FileName, bool WithKinematics, KinematicsKernel Kinematics = SelectKinematicsKernel( "auto" ) )
+			: m_withKinematics( WithKinematics ), m_kinematics( Kinematics ), m_offset( 0 )
+		{
+			m_file = fopen( FileName.c_str(), "wb" );
+			if ( !m_file ) return;
+
+			//Placeholder header, filled in by Close
+			BinaryEventHeader header;
+			memset( &header, 0, sizeof( header ) );
+			m_offset = this->Write( &header, sizeof( header ) );
+		}
+		~BinaryEventWriter()
+		{
+			this->Close();
+		}
+
+		bool IsOpen() const
+		{
+			return m_file != 0;
+		}
+
+		//Particles are sorted pT high to low first
+		void WriteEvent( ParticleArrays & Particles )
+		{
+			if ( !m_file ) return;
+			Particles.SortByPt();
+			unsigned int const total = Particles.size();
+
+			BinaryEventIndexEntry entry;
+			entry.offset = m_offset;
+			entry.particles = total;
+			m_index.push_back( entry );
+
+			this->WriteColumn( Particles.px );
+			this->WriteColumn( Particles.py );
+			this->WriteColumn( Particles.pz );
+			this->WriteColumn( Particles.E );
+			if ( !m_withKinematics ) return;
+
+			m_perp2s.resize( total );
+			m_rapidities.resize( total );
+			m_phis.resize( total );
+			m_kinematics( Particles.px.data(), Particles.py.data(), Particles.pz.data(), Particles.E.data(), 0, total, m_perp2s.data(), m_rapidities.data(), m_phis.data() );
+			this->WriteColumn( m_perp2s );
+			this->WriteColumn( m_rapidities );
+			this->WriteColumn( m_phis );
+		}
+
+		//Write the index and the real header, returns false if anything failed to write
+		bool Close()
+		{
+			if ( !m_file ) return false;
+
+			BinaryEventHeader header;
+			memset( &header, 0, sizeof( header ) );
+			header.magic = BinaryEventHeader::MAGIC;
+			header.version = BinaryEventHeader::VERSION;
+			header.flags = m_withKinematics ? BinaryEventHeader::KINEMATICS : 0;
+			if ( m_withKinematics && m_kinematics != KinematicsExact ) header.flags |= BinaryEventHeader::APPROXIMATE_KINEMATICS;
+			header.events = m_index.size();
+			header.indexOffset = m_offset;
+			if ( !m_index.empty() ) this->Write( &m_index[ 0 ], m_index.size() * sizeof( BinaryEventIndexEntry ) );
+
+			bool good = !ferror( m_file );
+			good = good && fseek( m_file, 0, SEEK_SET ) == 0 && fwrite( &header, sizeof( header ), 1, m_file ) == 1;
+			good = ( fclose( m_file ) == 0 ) && good;
+			m_file = 0;
+			return good;
+		}
+
+	private:
+		FILE * m_file;
+		bool m_withKinematics;
+		KinematicsKernel m_kinematics;
+		uint64_t m_offset;
+		std::vector< BinaryEventIndexEntry > m_index;
+		std::vector< double > m_perp2s, m_rapidities, m_phis;
+
+		uint64_t Write( void const * Data, size_t Bytes )
+		{
+			fwrite( Data, 1, Bytes, m_file );
+			return m_offset + Bytes;
+		}
+
+		void WriteColumn( std::vector< double > const& Column )
+		{
+			static char const ZEROS[ BinaryEventHeader::ALIGNMENT ] = {};
+			size_t const bytes = Column.size() * sizeof( double );
+			if ( bytes ) m_offset = this->Write( &Column[ 0 ], bytes );
+			m_offset = this->Write( ZEROS, BinaryColumnSize( Column.size() ) - bytes );
+		}
+
+		BinaryEventWriter( BinaryEventWriter const& );
+		BinaryEventWriter & operator=( BinaryEventWriter const& );
+};
+
+//Maps a binary event file and hands out views of any event through the index
+class BinaryEventReader
+{
+	public:
+		BinaryEventReader( std::string const& FileName ) : m_data( 0 ), m_size( 0 ), m_header( 0 ), m_index( 0 ), m_next( 0 )
+		{
+			int const file = open( FileName.c_str(), O_RDONLY );
+			if ( file < 0 ) return;
+
+			struct stat status;
+			if ( fstat( file, &status ) == 0 && status.st_size >= ( off_t )sizeof( BinaryEventHeader ) )
+			{
+				void * const data = mmap( 0, status.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+				if ( data != MAP_FAILED )
+				{
+					m_data = ( char const * )data;
+					m_size = status.st_size;
+				}
+			}
+			close( file );
+			if ( !m_data ) return;
+
+			//Check it is a complete file of the right kind
+			BinaryEventHeader const * const header = ( BinaryEventHeader const * )m_data;
+			if ( header->magic != BinaryEventHeader::MAGIC || header->version != BinaryEventHeader::VERSION ) return;
+			if ( header->indexOffset > m_size || ( m_size - header->indexOffset ) / sizeof( BinaryEventIndexEntry ) < header->events ) return;
+			BinaryEventIndexEntry const * const index = ( BinaryEventIndexEntry const * )( m_data + header->indexOffset );
+			uint64_t const columns = ( header->flags & BinaryEventHeader::KINEMATICS ) ? 7 : 4;
+			for ( uint64_t event = 0; event < header->events; event++ )
+			{
+				//Columns have to fit between the header and the index, worked out so nothing can wrap around
+				uint64_t const offset = index[ event ].offset;
+				if ( offset % BinaryEventHeader::ALIGNMENT || offset < sizeof( BinaryEventHeader ) || offset > header->indexOffset ) return;
+				uint64_t const columnBlocks = ( ( header->indexOffset - offset ) / columns ) / BinaryEventHeader::ALIGNMENT;
+				uint64_t const particles = index[ event ].particles;
+				if ( particles > UINT_MAX || particles > columnBlocks * ( BinaryEventHeader::ALIGNMENT / sizeof( double ) ) ) return;
+			}
+			m_header = header;
+			m_index = index;
+		}
+		~BinaryEventReader()
+		{
+			if ( m_data ) munmap( ( void * )m_data, m_size );
+		}
+
+		//False if the file is missing or isn't a binary event file
+		bool IsOpen() const
+		{
+			return m_header != 0;
+		}
+
+		uint64_t Events() const
+		{
+			return m_header ? m_header->events : 0;
+		}
+
+		bool HasKinematics() const
+		{
+			return m_header && ( m_header->flags & BinaryEventHeader::KINEMATICS );
+		}
+
+		//View of event number Event, which must be less than Events()
+		ParticleView Event( uint64_t Event ) const
+		{
+			BinaryEventIndexEntry const& entry = m_index[ Event ];
+			uint64_t const columnSize = BinaryColumnSize( entry.particles );
+			double const * const columns = ( double const * )( m_data + entry.offset );
+			unsigned int const stride = columnSize / sizeof( double );
+
+			ParticleView view;
+			view.particles = entry.particles;
+			view.px = columns;
+			view.py = columns + stride;
+			view.pz = columns + ( 2 * stride );
+			view.E = columns + ( 3 * stride );
+			if ( this->HasKinematics() )
+			{
+				view.perp2 = columns + ( 4 * stride );
+				view.rapidity = columns + ( 5 * stride );
+				view.phi = columns + ( 6 * stride );
+				view.exactKinematics = !( m_header->flags & BinaryEventHeader::APPROXIMATE_KINEMATICS );
+			}
+			return view;
+		}
+
+		//Events in order, returns false after the last one
+		bool ReadEvent( ParticleView & View )
+		{
+			if ( m_next >= this->Events() ) return false;
+			View = this->Event( m_next++ );
+			return true;
+		}
+
+		//Continue ReadEvent from event number Event
+		void Seek( uint64_t Event )
+		{
+			m_next = Event;
+		}
+
+	private:
+		char const * m_data;
+		size_t m_size;
+		BinaryEventHeader const * m_header;
+		BinaryEventIndexEntry const * m_index;
+		uint64_t m_next;
+
+		BinaryEventReader( BinaryEventReader const& );
+		BinaryEventReader & operator=( BinaryEventReader const& );
+};
+
+#endif
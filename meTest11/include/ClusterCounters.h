@@ -0,0 +1,224 @@
+#ifndef CLUSTER_COUNTERS_H
+#define CLUSTER_COUNTERS_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#ifdef JET_PERF_EVENTS
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+//Work counters for the clustering, switched on when compiling with -DJET_COUNTERS=1
+//Every update is behind "if ( COUNTERS )", so with the default of 0 the optimiser removes them and
+//there is nothing left in the hot loops. -DJET_PERF_EVENTS as well reads the hardware counters of
+//the clustering thread around each phase with perf_event_open. That costs a system call per phase
+//per iteration, so the timings are only meaningful without it, and work done by other TBB threads
+//in parallel updates isn't included.
+#ifndef JET_COUNTERS
+#ifdef JET_PERF_EVENTS
+#define JET_COUNTERS 1
+#else
+#define JET_COUNTERS 0
+#endif
+#endif
+
+bool const COUNTERS = JET_COUNTERS;
+
+//The phases timed in ClusterTiming
+enum ClusterPhase
+{
+	NEIGHBOUR_PHASE, //initial nearest neighbours
+	MIN_KT_PHASE,
+	UPDATE_PHASE,
+	HEAP_PHASE,
+	COMPACTION_PHASE,
+	TOTAL_PHASES
+};
+
+inline char const * PhaseName( unsigned int Phase )
+{
+	static char const * const NAMES[ TOTAL_PHASES ] = { "Initial neighbours", "Kt finding", "Collection update", "Heap update", "Compaction" };
+	return NAMES[ Phase ];
+}
+
+//Hardware events counted for each phase
+enum PerfEvent
+{
+	CYCLES_EVENT,
+	INSTRUCTIONS_EVENT,
+	L1D_MISS_EVENT,
+	LLC_MISS_EVENT,
+	BRANCH_MISS_EVENT,
+	TOTAL_EVENTS
+};
+
+inline char const * EventName( unsigned int Event )
+{
+	static char const * const NAMES[ TOTAL_EVENTS ] = { "cycles", "instructions", "L1D misses", "LLC misses", "branch misses" };
+	return NAMES[ Event ];
+}
+
+//Event counts at one moment, all zero if they can't be read
+struct PerfSample
+{
+	uint64_t values[ TOTAL_EVENTS ];
+};
+
+#ifdef JET_PERF_EVENTS
+//One group of hardware counters for the calling thread, user space only so it works without privileges
+//where perf_event_paranoid allows it. Opened on first use in each thread and kept open.
+class PerfEventGroup
+{
+	public:
+		static PerfEventGroup & ThisThread()
+		{
+			static thread_local PerfEventGroup group;
+			return group;
+		}
+
+		bool IsOpen() const
+		{
+			return m_leader >= 0;
+		}
+
+		void Read( PerfSample & Sample ) const
+		{
+			//Group read: number of events, then the values in the order they were opened
+			uint64_t buffer[ TOTAL_EVENTS + 1 ];
+			if ( m_leader < 0 || read( m_leader, buffer, sizeof( buffer ) ) != sizeof( buffer ) )
+			{
+				memset( Sample.values, 0, sizeof( Sample.values ) );
+				return;
+			}
+			memcpy( Sample.values, buffer + 1, sizeof( Sample.values ) );
+		}
+
+		~PerfEventGroup()
+		{
+			for ( unsigned int event = 0; event < TOTAL_EVENTS; event++ ) if ( m_files[ event ] >= 0 ) close( m_files[ event ] );
+		}
+
+	private:
+		int m_files[ TOTAL_EVENTS ];
+		int m_leader;
+
+		PerfEventGroup() : m_leader( -1 )
+		{
+			uint32_t const TYPES[ TOTAL_EVENTS ] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+			uint64_t const CONFIGS[ TOTAL_EVENTS ] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+				PERF_COUNT_HW_CACHE_L1D | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ),
+				PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+
+			for ( unsigned int event = 0; event < TOTAL_EVENTS; event++ )
+			{
+				perf_event_attr attributes;
+				memset( &attributes, 0, sizeof( attributes ) );
+				attributes.size = sizeof( attributes );
+				attributes.type = TYPES[ event ];
+				attributes.config = CONFIGS[ event ];
+				attributes.disabled = ( event == 0 );
+				attributes.exclude_kernel = 1;
+				attributes.exclude_hv = 1;
+				attributes.read_format = PERF_FORMAT_GROUP;
+				m_files[ event ] = syscall( __NR_perf_event_open, &attributes, 0, -1, event == 0 ? -1 : m_files[ 0 ], 0 );
+			}
+
+			//All or nothing, so the group read always has the same layout
+			for ( unsigned int event = 0; event < TOTAL_EVENTS; event++ )
+			{
+				if ( m_files[ event ] >= 0 ) continue;
+				for ( unsigned int other = 0; other < TOTAL_EVENTS; other++ )
+				{
+					if ( m_files[ other ] >= 0 ) close( m_files[ other ] );
+					m_files[ other ] = -1;
+				}
+				return;
+			}
+			m_leader = m_files[ 0 ];
+			ioctl( m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+			ioctl( m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+		}
+};
+#endif
+
+//What the clustering did, as opposed to how long it took
+struct ClusterCounters
+{
+	unsigned long pairsEvaluated; //delta_R^2 worked out, deleted objects in a scanned range included
+	unsigned long neighbourSearches; //objects whose nearest neighbour was searched for from scratch
+	unsigned long cacheChecks; //objects looked at after a merge or jet
+	unsigned long cacheHits; //of those, the ones whose cached neighbour stayed good without a search
+	unsigned long merges;
+	unsigned long jets;
+	unsigned long bytesTouched; //coordinates and flags read by the searches, and moved by compaction
+	uint64_t events[ TOTAL_PHASES ][ TOTAL_EVENTS ];
+	bool perfEvents; //whether events were read
+
+	ClusterCounters() : pairsEvaluated( 0 ), neighbourSearches( 0 ), cacheChecks( 0 ), cacheHits( 0 ), merges( 0 ), jets( 0 ), bytesTouched( 0 ), perfEvents( false )
+	{
+		memset( events, 0, sizeof( events ) );
+	}
+
+	ClusterCounters & operator+=( ClusterCounters const& Other )
+	{
+		pairsEvaluated += Other.pairsEvaluated;
+		neighbourSearches += Other.neighbourSearches;
+		cacheChecks += Other.cacheChecks;
+		cacheHits += Other.cacheHits;
+		merges += Other.merges;
+		jets += Other.jets;
+		bytesTouched += Other.bytesTouched;
+		for ( unsigned int phase = 0; phase < TOTAL_PHASES; phase++ )
+		{
+			for ( unsigned int event = 0; event < TOTAL_EVENTS; event++ ) events[ phase ][ event ] += Other.events[ phase ][ event ];
+		}
+		perfEvents = perfEvents || Other.perfEvents;
+		return *this;
+	}
+
+	//Hardware counters at the start of a phase, and adding up what happened by the end of it
+	//Both do nothing unless built with JET_PERF_EVENTS
+	void StartPhase( PerfSample & Start ) const
+	{
+#ifdef JET_PERF_EVENTS
+		PerfEventGroup::ThisThread().Read( Start );
+#else
+		( void )Start;
+#endif
+	}
+	void EndPhase( unsigned int Phase, PerfSample const& Start )
+	{
+#ifdef JET_PERF_EVENTS
+		PerfEventGroup & group = PerfEventGroup::ThisThread();
+		if ( !group.IsOpen() ) return;
+		PerfSample end;
+		group.Read( end );
+		for ( unsigned int event = 0; event < TOTAL_EVENTS; event++ ) events[ Phase ][ event ] += end.values[ event ] - Start.values[ event ];
+		perfEvents = true;
+#else
+		( void )Phase;
+		( void )Start;
+#endif
+	}
+
+	void Print() const
+	{
+		printf( "Pairs evaluated: %lu\n", pairsEvaluated );
+		printf( "Neighbour searches: %lu\n", neighbourSearches );
+		printf( "Cache hit ratio: %.4f (%lu of %lu)\n", cacheChecks ? double( cacheHits ) / double( cacheChecks ) : 0.0, cacheHits, cacheChecks );
+		printf( "Merges: %lu, jets: %lu\n", merges, jets );
+		printf( "Bytes touched: %lu\n", bytesTouched );
+		if ( !perfEvents ) return;
+		for ( unsigned int phase = 0; phase < TOTAL_PHASES; phase++ )
+		{
+			printf( "%s:", PhaseName( phase ) );
+			for ( unsigned int event = 0; event < TOTAL_EVENTS; event++ ) printf( " %llu %s%s", ( unsigned long long )events[ phase ][ event ], EventName( event ), event + 1 < TOTAL_EVENTS ? "," : "\n" );
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef CLUSTER_DISPATCH_H
+#define CLUSTER_DISPATCH_H
+
+#include <vector>
+
+#include "FourMomentum.h"
+#include "KtAlgorithms.h"
+#include "Clusterer.h"
+
+//What to run: p = -1 anti-kt, 0 Cambridge/Aachen, 1 kt, anything else generalised kt
+struct JetDefinition
+{
+	double p;
+	double R;
+
+	JetDefinition( double P = -1.0, double TheR = 0.6 ) : p( P ), R( TheR )
+	{
+	}
+};
+
+inline char const * AlgorithmName( JetDefinition const& Definition )
+{
+	if ( Definition.p == -1.0 ) return AntiKt::Name();
+	if ( Definition.p == 0.0 ) return CambridgeAachen::Name();
+	if ( Definition.p == 1.0 ) return Kt::Name();
+	return GeneralisedKt::Name();
+}
+
+template< class Algorithm, class Radius, class Particles >
+inline void RunClusterer( Algorithm const& TheAlgorithm, Radius const& TheRadius, ClusterOptions const& Options, ClusterWorkspace & Workspace,
+		Particles const& Inputs, std::vector< FourMomentum > & Outputs, ClusterTiming & Timing, GhostGrid const * Ghosts, std::vector< double > * Areas,
+		ClusterHistory * History, JetConstituents * Constituents )
+{
+	Clusterer< Algorithm, Radius > clusterer( TheAlgorithm, TheRadius, Options, &Workspace );
+	clusterer.Cluster( Inputs, Outputs, Ghosts, Areas, History, Constituents );
+	Timing = clusterer.Timing();
+}
+
+//Common radii get their own instantiation, anything else is a run time value
+template< class Algorithm, class Particles >
+inline void DispatchRadius( Algorithm const& TheAlgorithm, double R, ClusterOptions const& Options, ClusterWorkspace & Workspace,
+		Particles const& Inputs, std::vector< FourMomentum > & Outputs, ClusterTiming & Timing, GhostGrid const * Ghosts, std::vector< double > * Areas,
+		ClusterHistory * History, JetConstituents * Constituents )
+{
+	if ( R == 0.4 ) RunClusterer( TheAlgorithm, FixedRadius< 2, 5 >(), Options, Workspace, Inputs, Outputs, Timing, Ghosts, Areas, History, Constituents );
+	else if ( R == 0.6 ) RunClusterer( TheAlgorithm, FixedRadius< 3, 5 >(), Options, Workspace, Inputs, Outputs, Timing, Ghosts, Areas, History, Constituents );
+	else if ( R == 1.0 ) RunClusterer( TheAlgorithm, FixedRadius< 1, 1 >(), Options, Workspace, Inputs, Outputs, Timing, Ghosts, Areas, History, Constituents );
+	else RunClusterer( TheAlgorithm, RuntimeRadius( R ), Options, Workspace, Inputs, Outputs, Timing, Ghosts, Areas, History, Constituents );
+}
+
+template< class Particles >
+inline void DispatchAlgorithm( JetDefinition const& Definition, ClusterOptions const& Options, ClusterWorkspace & Workspace,
+		Particles const& Inputs, std::vector< FourMomentum > & Outputs, ClusterTiming & Timing, GhostGrid const * Ghosts, std::vector< double > * Areas,
+		ClusterHistory * History, JetConstituents * Constituents )
+{
+	if ( Definition.p == -1.0 ) DispatchRadius( AntiKt(), Definition.R, Options, Workspace, Inputs, Outputs, Timing, Ghosts, Areas, History, Constituents );
+	else if ( Definition.p == 0.0 ) DispatchRadius( CambridgeAachen(), Definition.R, Options, Workspace, Inputs, Outputs, Timing, Ghosts, Areas, History, Constituents );
+	else if ( Definition.p == 1.0 ) DispatchRadius( Kt(), Definition.R, Options, Workspace, Inputs, Outputs, Timing, Ghosts, Areas, History, Constituents );
+	else DispatchRadius( GeneralisedKt( Definition.p ), Definition.R, Options, Workspace, Inputs, Outputs, Timing, Ghosts, Areas, History, Constituents );
+}
+
+//Pick the specialised clustering for a jet definition
+//Inputs are a vector of four-vectors, ParticleArrays or a ParticleView, sorted pT high to low
+//Jets are added to Outputs, so clear it first when reusing it for another event
+template< class Particles >
+inline void ClusterJets( JetDefinition const& Definition, ClusterOptions const& Options, ClusterWorkspace & Workspace,
+		Particles const& Inputs, std::vector< FourMomentum > & Outputs, ClusterTiming & Timing )
+{
+	DispatchAlgorithm( Definition, Options, Workspace, Inputs, Outputs, Timing, 0, 0, 0, 0 );
+}
+
+//The same with active areas: the ghosts are clustered with the inputs, and Areas gets the area of each
+//jet in the order of Outputs. Jets of nothing but ghosts are left out.
+template< class Particles >
+inline void ClusterJets( JetDefinition const& Definition, ClusterOptions const& Options, ClusterWorkspace & Workspace,
+		Particles const& Inputs, GhostGrid const& Ghosts, std::vector< FourMomentum > & Outputs, std::vector< double > & Areas, ClusterTiming & Timing )
+{
+	DispatchAlgorithm( Definition, Options, Workspace, Inputs, Outputs, Timing, &Ghosts, &Areas, 0, 0 );
+}
+
+//The same keeping the clustering history, for exclusive jets at any multiplicity or dcut afterwards
+template< class Particles >
+inline void ClusterJets( JetDefinition const& Definition, ClusterOptions const& Options, ClusterWorkspace & Workspace,
+		Particles const& Inputs, std::vector< FourMomentum > & Outputs, ClusterHistory & History, ClusterTiming & Timing )
+{
+	DispatchAlgorithm( Definition, Options, Workspace, Inputs, Outputs, Timing, 0, 0, &History, 0 );
+}
+
+//The most general: ghosts, areas, history and constituents are each optional, 0 to go without
+//Constituents get the inputs of each jet in the order of Outputs, and are added to in the same way
+template< class Particles >
+inline void ClusterJets( JetDefinition const& Definition, ClusterOptions const& Options, ClusterWorkspace & Workspace,
+		Particles const& Inputs, GhostGrid const * Ghosts, std::vector< FourMomentum > & Outputs, std::vector< double > * Areas,
+		ClusterHistory * History, JetConstituents * Constituents, ClusterTiming & Timing )
+{
+	DispatchAlgorithm( Definition, Options, Workspace, Inputs, Outputs, Timing, Ghosts, Areas, History, Constituents );
+}
+
+#endif
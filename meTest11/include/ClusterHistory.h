@@ -0,0 +1,159 @@
+#ifndef CLUSTER_HISTORY_H
+#define CLUSTER_HISTORY_H
+
+#include <vector>
+#include <algorithm>
+
+#include "FourMomentum.h"
+
+//One entry of the clustering history: an input particle, a merge of two earlier entries, or an
+//entry becoming an inclusive jet. Parents are history indices, and always lower than the entry's own.
+struct ClusterStep
+{
+	enum Type
+	{
+		INPUT,
+		MERGE,
+		BEAM
+	};
+	static unsigned int const NO_PARENT = ~0u;
+
+	unsigned int parent1;
+	unsigned int parent2; //NO_PARENT for an input or a jet
+	unsigned int type;
+	double dij; //kt^2 distance that made the step, 0 for an input
+	double maxDij; //largest dij of this step and every one before it
+};
+
+//The merge sequence of one event, as the clusterer made it: the N inputs first, then one step per
+//iteration, so a complete history has 2N entries and after step k there are N - k objects left.
+//The exclusive queries read it from the end, so they cost about as much as the jets they return,
+//and asking for several multiplicities never reclusters.
+//The exclusive jets are only meaningful for algorithms where dij grows as the clustering goes on:
+//kt and Cambridge/Aachen. With ghosts for areas the clustering stops early, so there's no history.
+class ClusterHistory
+{
+	public:
+		ClusterHistory() : m_inputs( 0 ), m_totalEnergy( 0.0 )
+		{
+		}
+
+		//Start a new event of Inputs particles
+		void Reset( unsigned int Inputs )
+		{
+			m_steps.clear();
+			m_momenta.clear();
+			m_steps.reserve( 2 * Inputs );
+			m_momenta.reserve( 2 * Inputs );
+			m_inputs = Inputs;
+			m_totalEnergy = 0.0;
+		}
+
+		//Each adds an entry and returns its index
+		unsigned int AddInput( FourMomentum const& Momentum )
+		{
+			m_totalEnergy += Momentum.E();
+			return this->AddStep( ClusterStep::INPUT, ClusterStep::NO_PARENT, ClusterStep::NO_PARENT, 0.0, Momentum );
+		}
+		unsigned int AddMerge( unsigned int Parent1, unsigned int Parent2, double Dij, FourMomentum const& Momentum )
+		{
+			return this->AddStep( ClusterStep::MERGE, Parent1, Parent2, Dij, Momentum );
+		}
+		unsigned int AddBeam( unsigned int Parent, double Dij )
+		{
+			return this->AddStep( ClusterStep::BEAM, Parent, ClusterStep::NO_PARENT, Dij, m_momenta[ Parent ] );
+		}
+
+		unsigned int size() const
+		{
+			return m_steps.size();
+		}
+		unsigned int Inputs() const
+		{
+			return m_inputs;
+		}
+		//Whether every object ended up in a jet
+		bool IsComplete() const
+		{
+			return m_steps.size() == 2 * m_inputs;
+		}
+		ClusterStep const& Step( unsigned int Index ) const
+		{
+			return m_steps[ Index ];
+		}
+		//Momentum of the object an entry made, or of the jet for a beam step
+		FourMomentum const& Momentum( unsigned int Index ) const
+		{
+			return m_momenta[ Index ];
+		}
+
+		//The jets the clustering produced, in the order it produced them
+		void InclusiveJets( std::vector< FourMomentum > & Jets, double MinPt = 0.0 ) const
+		{
+			Jets.clear();
+			for ( unsigned int index = m_inputs; index < m_steps.size(); index++ )
+			{
+				if ( m_steps[ index ].type == ClusterStep::BEAM && m_momenta[ index ].Pt() >= MinPt ) Jets.push_back( m_momenta[ index ] );
+			}
+		}
+
+		//The objects left when the clustering is stopped with Jets of them, at most the number of inputs
+		void ExclusiveJets( unsigned int Jets, std::vector< FourMomentum > & Outputs ) const
+		{
+			Outputs.clear();
+			if ( !this->IsComplete() ) return;
+			unsigned int const stopPoint = m_steps.size() - std::min( Jets, m_inputs );
+			for ( unsigned int index = stopPoint; index < m_steps.size(); index++ )
+			{
+				ClusterStep const& step = m_steps[ index ];
+				if ( step.parent1 < stopPoint ) Outputs.push_back( m_momenta[ step.parent1 ] );
+				if ( step.parent2 != ClusterStep::NO_PARENT && step.parent2 < stopPoint ) Outputs.push_back( m_momenta[ step.parent2 ] );
+			}
+		}
+
+		//Number of objects left when every step made with dij above Dcut is undone
+		unsigned int ExclusiveJetCount( double Dcut ) const
+		{
+			if ( !this->IsComplete() ) return 0;
+			unsigned int stopPoint = m_steps.size();
+			while ( stopPoint > 0 && m_steps[ stopPoint - 1 ].maxDij > Dcut ) stopPoint--;
+			return m_steps.size() - std::max( stopPoint, m_inputs );
+		}
+		void ExclusiveJets( double Dcut, std::vector< FourMomentum > & Outputs ) const
+		{
+			this->ExclusiveJets( this->ExclusiveJetCount( Dcut ), Outputs );
+		}
+
+		//dij of the step that goes from Jets + 1 objects to Jets, 0 if there never were that many
+		double ExclusiveDmerge( unsigned int Jets ) const
+		{
+			if ( !this->IsComplete() || Jets >= m_inputs ) return 0.0;
+			return m_steps[ m_steps.size() - Jets - 1 ].dij;
+		}
+		//The same divided by the squared total energy of the inputs
+		double ExclusiveYmerge( unsigned int Jets ) const
+		{
+			return m_totalEnergy > 0.0 ? this->ExclusiveDmerge( Jets ) / ( m_totalEnergy * m_totalEnergy ) : 0.0;
+		}
+
+	private:
+		std::vector< ClusterStep > m_steps;
+		std::vector< FourMomentum > m_momenta;
+		unsigned int m_inputs;
+		double m_totalEnergy;
+
+		unsigned int AddStep( unsigned int Type, unsigned int Parent1, unsigned int Parent2, double Dij, FourMomentum const& Momentum )
+		{
+			ClusterStep step;
+			step.parent1 = Parent1;
+			step.parent2 = Parent2;
+			step.type = Type;
+			step.dij = Dij;
+			step.maxDij = m_steps.empty() ? Dij : std::max( Dij, m_steps.back().maxDij );
+			m_steps.push_back( step );
+			m_momenta.push_back( Momentum );
+			return m_steps.size() - 1;
+		}
+};
+
+#endif
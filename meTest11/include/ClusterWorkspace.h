@@ -0,0 +1,83 @@
+#ifndef CLUSTER_WORKSPACE_H
+#define CLUSTER_WORKSPACE_H
+
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+
+#include "IndexedMinHeap.h"
+
+//Memory for the clustering arrays, kept between events so a run of events settles down to no
+//allocation at all. One 64-byte aligned block is carved up for each event and handed back all at
+//once by the next Reset, which only allocates if the block is too small, and then at least doubles it.
+class ClusterWorkspace
+{
+	public:
+		static size_t const ALIGNMENT = 64;
+
+		ClusterWorkspace() : m_buffer( 0 ), m_capacity( 0 ), m_used( 0 ), m_growths( 0 ), m_heap( 0 )
+		{
+		}
+		~ClusterWorkspace()
+		{
+			free( m_buffer );
+		}
+
+		//Bytes needed for an array, padded so the next one stays aligned
+		template< class T >
+		static size_t AlignedSize( size_t Count )
+		{
+			return ( ( ( Count * sizeof( T ) ) + ALIGNMENT - 1 ) / ALIGNMENT ) * ALIGNMENT;
+		}
+
+		//Start a new event that needs Bytes in total, earlier arrays are no longer valid
+		void Reset( size_t Bytes, unsigned int HeapCapacity )
+		{
+			m_used = 0;
+			m_heap.Reset( HeapCapacity );
+			if ( Bytes <= m_capacity ) return;
+
+			size_t newCapacity = m_capacity * 2;
+			if ( newCapacity < Bytes ) newCapacity = Bytes;
+			free( m_buffer );
+			m_buffer = 0;
+			m_capacity = 0;
+			if ( posix_memalign( ( void ** )&m_buffer, ALIGNMENT, newCapacity ) ) throw std::bad_alloc();
+			m_capacity = newCapacity;
+			m_growths++;
+		}
+
+		//Uninitialised array from the current event's block
+		template< class T >
+		T * Allocate( size_t Count )
+		{
+			size_t const bytes = AlignedSize< T >( Count );
+			if ( m_used + bytes > m_capacity ) throw std::bad_alloc();
+			T * const result = ( T * )( m_buffer + m_used );
+			m_used += bytes;
+			return result;
+		}
+
+		IndexedMinHeap & Heap()
+		{
+			return m_heap;
+		}
+
+		//How many times the block has been (re)allocated
+		unsigned int Growths() const
+		{
+			return m_growths;
+		}
+
+	private:
+		char * m_buffer;
+		size_t m_capacity;
+		size_t m_used;
+		unsigned int m_growths;
+		IndexedMinHeap m_heap;
+
+		ClusterWorkspace( ClusterWorkspace const& );
+		ClusterWorkspace & operator=( ClusterWorkspace const& );
+};
+
+#endif
@@ -0,0 +1,758 @@
+#ifndef CLUSTERER_H
+#define CLUSTERER_H
+
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <atomic>
+
+#include "tbb/tick_count.h"
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+
+#include "FourMomentum.h"
+#include "KtAlgorithms.h"
+#include "NeighbourKernels.h"
+#include "KinematicsKernels.h"
+#include "IndexedMinHeap.h"
+#include "ClusterWorkspace.h"
+#include "ParticleArrays.h"
+#include "ClusterCounters.h"
+#include "GhostGrid.h"
+#include "ClusterHistory.h"
+#include "JetConstituents.h"
+
+//Accumulated time in each phase of the clustering, how often single precision had to be re-done,
+//and the work counters if they are compiled in
+struct ClusterTiming
+{
+	tbb::tick_count::interval_t findMinKtTime;
+	tbb::tick_count::interval_t updateCollectionsTime;
+	tbb::tick_count::interval_t heapUpdateTime;
+	tbb::tick_count::interval_t compactionTime;
+	tbb::tick_count::interval_t totalTime;
+	unsigned int doublePrecisionRechecks;
+	unsigned int compactions;
+	ClusterCounters counters;
+
+	ClusterTiming() : doublePrecisionRechecks( 0 ), compactions( 0 )
+	{
+	}
+};
+
+//Squared distance in rapidity and phi, written the same way as the neighbour kernels
+inline double DeltaR2( double ThisPhi, double ThisRapidity, double PairPhi, double PairRapidity )
+{
+	double const TWO_PI = 2.0 * M_PI;
+	double deltaPhi = fabs( ThisPhi - PairPhi );
+	deltaPhi = std::min( deltaPhi, TWO_PI - deltaPhi );
+	double const deltaRapidity = ThisRapidity - PairRapidity;
+	return ( deltaPhi * deltaPhi ) + ( deltaRapidity * deltaRapidity );
+}
+
+//Four-momenta of the input particles, for each kind of input
+//A vector of anything with TLorentzVector's accessors works, so ROOT inputs need no conversion
+template< class Momenta >
+inline void LoadMomenta( std::vector< Momenta > const& Particles, double * Pxs, double * Pys, double * Pzs, double * Energies )
+{
+	for ( unsigned int i = 0; i < Particles.size(); i++ )
+	{
+		Pxs[ i ] = Particles[ i ].Px();
+		Pys[ i ] = Particles[ i ].Py();
+		Pzs[ i ] = Particles[ i ].Pz();
+		Energies[ i ] = Particles[ i ].E();
+	}
+}
+inline void LoadMomenta( ParticleArrays const& Particles, double * Pxs, double * Pys, double * Pzs, double * Energies )
+{
+	std::copy( Particles.px.begin(), Particles.px.end(), Pxs );
+	std::copy( Particles.py.begin(), Particles.py.end(), Pys );
+	std::copy( Particles.pz.begin(), Particles.pz.end(), Pzs );
+	std::copy( Particles.E.begin(), Particles.E.end(), Energies );
+}
+inline void LoadMomenta( ParticleView const& Particles, double * Pxs, double * Pys, double * Pzs, double * Energies )
+{
+	std::copy( Particles.px, Particles.px + Particles.particles, Pxs );
+	std::copy( Particles.py, Particles.py + Particles.particles, Pys );
+	std::copy( Particles.pz, Particles.pz + Particles.particles, Pzs );
+	std::copy( Particles.E, Particles.E + Particles.particles, Energies );
+}
+
+//pT^2, rapidity and phi stored with the input, false if there are none and they have to be worked out
+//Stored values are only used if they came from the same kind of kernel as Kinematics, libm or the
+//approximations, so the inputs match the merged objects Kinematics works out later
+template< class Particles >
+inline bool LoadKinematics( Particles const&, KinematicsKernel, double *, double *, double * )
+{
+	return false;
+}
+inline bool LoadKinematics( ParticleView const& Particles, KinematicsKernel Kinematics, double * Perp2s, double * Rapidities, double * Phis )
+{
+	if ( !Particles.phi || Particles.exactKinematics != ( Kinematics == KinematicsExact ) ) return false;
+	std::copy( Particles.perp2, Particles.perp2 + Particles.particles, Perp2s );
+	std::copy( Particles.rapidity, Particles.rapidity + Particles.particles, Rapidities );
+	std::copy( Particles.phi, Particles.phi + Particles.particles, Phis );
+	return true;
+}
+
+//Nearest neighbours stored with the input, false if there are none and they have to be searched for
+//They don't depend on the algorithm or R, so clustering one event several ways only needs them once
+template< class Particles >
+inline bool LoadNeighbours( Particles const&, double *, unsigned int * )
+{
+	return false;
+}
+inline bool LoadNeighbours( ParticleView const& Particles, double * NearestDeltaR2s, unsigned int * NearestNeighbours )
+{
+	if ( !Particles.nearestNeighbour ) return false;
+	std::copy( Particles.nearestDeltaR2, Particles.nearestDeltaR2 + Particles.particles, NearestDeltaR2s );
+	std::copy( Particles.nearestNeighbour, Particles.nearestNeighbour + Particles.particles, NearestNeighbours );
+	return true;
+}
+
+//Implementation choices that don't change the jets
+//The approximate kinematics kernels can move a coordinate by an ulp or two, which could only matter
+//for an exact tie between distances
+struct ClusterOptions
+{
+	NearestNeighbourKernel kernel;
+	NearestNeighbourKernelFloat floatKernel;
+	KinematicsKernel kinematics;
+	bool singlePrecision;
+	double compactionThreshold; //squeeze out deleted objects when fewer than this fraction of the active range is live, 0 never
+	unsigned int parallelThreshold; //split the neighbour updates over TBB workers while at least this many objects are active, 0 never
+
+	ClusterOptions() : kernel( SelectNearestNeighbourKernel( "auto" ) ), floatKernel( SelectNearestNeighbourKernelFloat( "auto" ) ),
+		kinematics( SelectKinematicsKernel( "auto" ) ),
+		singlePrecision( false ), compactionThreshold( 0.0 ), parallelThreshold( 0 )
+	{
+	}
+};
+
+//Largest possible difference between delta_R^2 from the float kernels and from the double ones,
+//for coordinates no bigger than CoordinateScale in magnitude. Each float coordinate is off by at most
+//half an ulp, so a wrapped delta is off by at most 6 u CoordinateScale, then squaring and adding
+//the two deltas adds the rest. Doubled to keep well clear of the edge.
+inline double FloatDeltaR2Error( double DeltaR2, double CoordinateScale )
+{
+	double const u = 0.5 * FLT_EPSILON;
+	double const deltaError = 6.0 * u * CoordinateScale;
+	return 2.0 * ( ( 2.0 * deltaError * sqrt( 2.0 * DeltaR2 ) ) + ( 2.0 * deltaError * deltaError ) + ( 4.0 * u * DeltaR2 ) );
+}
+
+//Generalised kt clustering. The smallest pair kt^2 is always between geometric nearest neighbours
+//for any p, so each object caches its nearest neighbour over all active objects, and the algorithm
+//and radius only enter when that is turned into a kt^2.
+//Merged objects are offered to every other object, so the cache is exact.
+//In single precision the neighbour searches run on float copies of the coordinates, and any search
+//whose best two candidates are within rounding of each other is re-done in double, so the merge
+//sequence is the same as in double precision.
+//The minimum kt^2 comes from a heap, which is brought up to date once per iteration with just the
+//objects whose kt^2 changed.
+//Deleted objects are normally just skipped, but can also be compacted away so the loops only see
+//live data. Compaction keeps the objects in order, so ties still break the same way.
+//The arrays come from a workspace, which can be shared between clusterers to reuse the memory.
+//For big events the neighbour updates can be shared between TBB workers. Each object's update only
+//writes to that object, so the result doesn't depend on how the work is split.
+//For jet areas the ghosts of a GhostGrid go in front of the inputs, in grid order, and the kernels
+//never scan them. Distances between ghosts are fixed by the grid, so a search finds the nearest ghost
+//from the cells around it, and after a merge only the ghosts near it are checked. A merge with a ghost
+//keeps the other object's index, and two ghosts merge into a new object after the inputs, so everything
+//past the ghosts is real particles or merged objects.
+//Each object knows its entry in the history if one is kept, so recording a step costs two lookups.
+//Constituents are linked lists threaded through the objects, one next index per input and a first
+//and last per object, so a merge joins two lists in constant time and nothing is allocated until
+//a jet's list is copied out.
+template< class Algorithm, class Radius >
+class Clusterer
+{
+	public:
+		Clusterer( Algorithm const& TheAlgorithm = Algorithm(), Radius const& TheRadius = Radius(), ClusterOptions const& Options = ClusterOptions(),
+				ClusterWorkspace * Workspace = 0 )
+			: m_algorithm( TheAlgorithm ), m_radius( TheRadius ), m_options( Options ), m_workspace( Workspace ? Workspace : &m_ownWorkspace )
+		{
+		}
+
+		ClusterTiming const& Timing() const
+		{
+			return m_timing;
+		}
+
+		//Inputs should be sorted pT high to low for speed, either a vector of four-vectors, ParticleArrays or a ParticleView
+		//With Ghosts, the area of each jet goes in Areas, and jets made only of ghosts are left out
+		//With History and no ghosts, every step is recorded there as well
+		//Constituents gets the inputs in each jet added, in the same order as the jets are added to Outputs
+		template< class Particles >
+		void Cluster( Particles const& Inputs, std::vector< FourMomentum > & Outputs, GhostGrid const * Ghosts = 0, std::vector< double > * Areas = 0,
+				ClusterHistory * History = 0, JetConstituents * Constituents = 0 )
+		{
+			unsigned int const totalObjects = Inputs.size() + ( Ghosts ? Ghosts->size() : 0 );
+			if ( m_options.parallelThreshold && totalObjects >= m_options.parallelThreshold ) this->ClusterEvent< true >( Inputs, Ghosts, Outputs, Areas, History, Constituents );
+			else this->ClusterEvent< false >( Inputs, Ghosts, Outputs, Areas, History, Constituents );
+		}
+
+	private:
+		Algorithm m_algorithm;
+		Radius m_radius;
+		ClusterOptions m_options;
+		ClusterTiming m_timing;
+		ClusterWorkspace m_ownWorkspace;
+		ClusterWorkspace * m_workspace;
+
+		//The serial version is separate because handing the loop state to TBB stops the compiler
+		//keeping it in registers, which costs ~10% even when nothing runs in parallel
+		template< bool PARALLEL, class Particles >
+		void ClusterEvent( Particles const& Inputs, GhostGrid const * Ghosts, std::vector< FourMomentum > & Outputs, std::vector< double > * Areas,
+				ClusterHistory * History, JetConstituents * Constituents )
+		{
+			//Copy input data into flat arrays, after the ghosts and with room for the objects made by merging ghosts
+			unsigned int const totalGhosts = Ghosts ? Ghosts->size() : 0;
+			unsigned int const totalInputs = Inputs.size();
+			unsigned int const totalObjects = totalGhosts + totalInputs;
+			unsigned int const totalSlots = totalObjects + totalGhosts;
+			m_workspace->Reset( ( 9 * ClusterWorkspace::AlignedSize< double >( totalSlots ) )
+					+ ( 2 * ClusterWorkspace::AlignedSize< float >( totalSlots ) )
+					+ ( 8 * ClusterWorkspace::AlignedSize< unsigned int >( totalSlots ) )
+					+ ( 4 * ClusterWorkspace::AlignedSize< bool >( totalSlots ) ), totalSlots );
+			double * const phis = m_workspace->Allocate< double >( totalSlots );
+			double * const rapidities = m_workspace->Allocate< double >( totalSlots );
+			double * const weights = m_workspace->Allocate< double >( totalSlots );
+			double * const energies = m_workspace->Allocate< double >( totalSlots );
+			double * const pxs = m_workspace->Allocate< double >( totalSlots );
+			double * const pys = m_workspace->Allocate< double >( totalSlots );
+			double * const pzs = m_workspace->Allocate< double >( totalSlots );
+			double * const nearestDeltaR2s = m_workspace->Allocate< double >( totalSlots );
+			unsigned int * const nearestNeighbours = m_workspace->Allocate< unsigned int >( totalSlots );
+			double * const cachedMinKts = m_workspace->Allocate< double >( totalSlots );
+			bool * const wasDeleted = m_workspace->Allocate< bool >( totalSlots );
+			float * const floatPhis = m_workspace->Allocate< float >( totalSlots );
+			float * const floatRapidities = m_workspace->Allocate< float >( totalSlots );
+			double coordinateScale = 2.0 * M_PI;
+			bool * const isStale = m_workspace->Allocate< bool >( totalSlots );
+			unsigned int * const staleObjects = m_workspace->Allocate< unsigned int >( totalSlots );
+			unsigned int totalStale = 0;
+			IndexedMinHeap & minKts = m_workspace->Heap();
+			unsigned int * const newIndices = m_workspace->Allocate< unsigned int >( totalSlots );
+			bool * const wasRefreshed = m_workspace->Allocate< bool >( totalSlots );
+			bool inParallel = false;
+
+			//Ghosts in each object for the areas, and whether it has any real particles
+			unsigned int * const ghostCounts = m_workspace->Allocate< unsigned int >( totalSlots );
+			bool * const isGhostOnly = m_workspace->Allocate< bool >( totalSlots );
+			unsigned int liveGhosts = totalGhosts;
+			unsigned int liveRealObjects = totalInputs; //objects with at least one real particle
+			double maxGhostDeltaR2 = 0.0; //no live ghost has its nearest neighbour further away than this
+
+			//Each object's entry in the history
+			ClusterHistory * const history = Ghosts ? 0 : History;
+			unsigned int * const historyIndices = m_workspace->Allocate< unsigned int >( totalSlots );
+
+			//Constituent lists: first and last object of each slot's list, and the next after each original object
+			unsigned int const LIST_END = ~0u;
+			unsigned int * const firstConstituents = m_workspace->Allocate< unsigned int >( totalSlots );
+			unsigned int * const lastConstituents = m_workspace->Allocate< unsigned int >( totalSlots );
+			unsigned int * const nextConstituents = m_workspace->Allocate< unsigned int >( totalSlots );
+			std::atomic< unsigned int > doublePrecisionRechecks( 0 );
+			std::atomic< unsigned long > pairsEvaluated( 0 );
+			std::atomic< unsigned long > neighbourSearches( 0 );
+			std::atomic< unsigned long > bytesTouched( 0 );
+
+			//Kinematics of the whole event in one pass, weights holds pT^2 until it's turned into the weights
+			//The ghosts are exactly on the grid, so their coordinates are set rather than worked out
+			LoadMomenta( Inputs, pxs + totalGhosts, pys + totalGhosts, pzs + totalGhosts, energies + totalGhosts );
+			if ( !LoadKinematics( Inputs, m_options.kinematics, weights + totalGhosts, rapidities + totalGhosts, phis + totalGhosts ) )
+			{
+				m_options.kinematics( pxs, pys, pzs, energies, totalGhosts, totalObjects, weights, rapidities, phis );
+			}
+			for ( unsigned int i = 0; i < totalGhosts; i++ )
+			{
+				Ghosts->Momentum( i, pxs[ i ], pys[ i ], pzs[ i ], energies[ i ] );
+				weights[ i ] = Ghosts->ghostPt * Ghosts->ghostPt;
+				rapidities[ i ] = Ghosts->Rapidity( i );
+				phis[ i ] = Ghosts->Phi( i );
+			}
+			bool const withAreas = Ghosts || Areas;
+			if ( withAreas )
+			{
+				for ( unsigned int i = 0; i < totalSlots; i++ )
+				{
+					ghostCounts[ i ] = ( i < totalGhosts );
+					isGhostOnly[ i ] = ( i < totalGhosts );
+				}
+			}
+			if ( history )
+			{
+				history->Reset( totalInputs );
+				for ( unsigned int i = 0; i < totalInputs; i++ ) historyIndices[ i ] = history->AddInput( FourMomentum( pxs[ i ], pys[ i ], pzs[ i ], energies[ i ] ) );
+			}
+			if ( Constituents )
+			{
+				Constituents->Reserve( totalInputs, totalInputs );
+				for ( unsigned int i = 0; i < totalObjects; i++ )
+				{
+					firstConstituents[ i ] = i;
+					lastConstituents[ i ] = i;
+					nextConstituents[ i ] = LIST_END;
+				}
+			}
+			for ( unsigned int i = 0; i < totalGhosts; i++ ) newIndices[ i ] = i;
+			for ( unsigned int i = 0; i < totalObjects; i++ )
+			{
+				weights[ i ] = m_algorithm.Weight( weights[ i ] );
+				nearestDeltaR2s[ i ] = DBL_MAX;
+				nearestNeighbours[ i ] = i;
+				cachedMinKts[ i ] = DBL_MAX;
+				wasDeleted[ i ] = false;
+				isStale[ i ] = false;
+				wasRefreshed[ i ] = false;
+				floatPhis[ i ] = phis[ i ];
+				floatRapidities[ i ] = rapidities[ i ];
+				coordinateScale = std::max( coordinateScale, fabs( rapidities[ i ] ) );
+			}
+
+			//Range the kernels search, always past the ghosts
+			unsigned int firstActive = totalGhosts;
+			unsigned int lastActive = totalObjects;
+
+			//Objects whose heap entry needs updating
+			//Parallel updates can't share the list, so they just flag the object and it is listed afterwards
+			auto markStale = [&]( unsigned int thisObjectIndex )
+			{
+				if ( inParallel )
+				{
+					wasRefreshed[ thisObjectIndex ] = true;
+					return;
+				}
+				if ( isStale[ thisObjectIndex ] ) return;
+				isStale[ thisObjectIndex ] = true;
+				staleObjects[ totalStale++ ] = thisObjectIndex;
+			};
+
+			//Bring the heap up to date
+			auto updateHeap = [&]()
+			{
+				tbb::tick_count const startHeapTime = tbb::tick_count::now();
+				PerfSample startHeapEvents;
+				m_timing.counters.StartPhase( startHeapEvents );
+				for ( unsigned int staleIndex = 0; staleIndex < totalStale; staleIndex++ )
+				{
+					unsigned int const thisObjectIndex = staleObjects[ staleIndex ];
+					if ( wasDeleted[ thisObjectIndex ] ) minKts.Remove( thisObjectIndex );
+					else minKts.Set( thisObjectIndex, cachedMinKts[ thisObjectIndex ] );
+					isStale[ thisObjectIndex ] = false;
+				}
+				totalStale = 0;
+				m_timing.heapUpdateTime += tbb::tick_count::now() - startHeapTime;
+				m_timing.counters.EndPhase( HEAP_PHASE, startHeapEvents );
+			};
+
+			//Update objects in a range, on several threads if there are enough of them
+			auto forEachObject = [&]( unsigned int Begin, unsigned int End, auto const& Update )
+			{
+				if ( !PARALLEL || End - Begin < m_options.parallelThreshold )
+				{
+					for ( unsigned int thisObjectIndex = Begin; thisObjectIndex < End; thisObjectIndex++ ) Update( thisObjectIndex );
+					return;
+				}
+
+				inParallel = true;
+				tbb::parallel_for( tbb::blocked_range< unsigned int >( Begin, End, 1024 ), [&]( tbb::blocked_range< unsigned int > const& Range )
+				{
+					for ( unsigned int thisObjectIndex = Range.begin(); thisObjectIndex < Range.end(); thisObjectIndex++ ) Update( thisObjectIndex );
+				} );
+				inParallel = false;
+
+				for ( unsigned int thisObjectIndex = Begin; thisObjectIndex < End; thisObjectIndex++ )
+				{
+					if ( !wasRefreshed[ thisObjectIndex ] ) continue;
+					wasRefreshed[ thisObjectIndex ] = false;
+					markStale( thisObjectIndex );
+				}
+			};
+
+			//Move the live objects to the front of the arrays and renumber them
+			auto compact = [&]()
+			{
+				tbb::tick_count const startCompactionTime = tbb::tick_count::now();
+				PerfSample startCompactionEvents;
+				m_timing.counters.StartPhase( startCompactionEvents );
+				unsigned int liveObjects = totalGhosts;
+				for ( unsigned int thisObjectIndex = firstActive; thisObjectIndex < lastActive; thisObjectIndex++ )
+				{
+					if ( !wasDeleted[ thisObjectIndex ] ) newIndices[ thisObjectIndex ] = liveObjects++;
+				}
+
+				//New indices are never above the old ones, so this can be done in place
+				//Ghosts stay where they are, but their neighbours may have moved
+				minKts.Clear();
+				for ( unsigned int thisObjectIndex = 0; liveGhosts && thisObjectIndex < totalGhosts; thisObjectIndex++ )
+				{
+					if ( wasDeleted[ thisObjectIndex ] ) continue;
+					nearestNeighbours[ thisObjectIndex ] = newIndices[ nearestNeighbours[ thisObjectIndex ] ];
+					minKts.Set( thisObjectIndex, cachedMinKts[ thisObjectIndex ] );
+				}
+				for ( unsigned int thisObjectIndex = firstActive; thisObjectIndex < lastActive; thisObjectIndex++ )
+				{
+					if ( wasDeleted[ thisObjectIndex ] ) continue;
+
+					unsigned int const newIndex = newIndices[ thisObjectIndex ];
+					phis[ newIndex ] = phis[ thisObjectIndex ];
+					rapidities[ newIndex ] = rapidities[ thisObjectIndex ];
+					weights[ newIndex ] = weights[ thisObjectIndex ];
+					energies[ newIndex ] = energies[ thisObjectIndex ];
+					pxs[ newIndex ] = pxs[ thisObjectIndex ];
+					pys[ newIndex ] = pys[ thisObjectIndex ];
+					pzs[ newIndex ] = pzs[ thisObjectIndex ];
+					nearestDeltaR2s[ newIndex ] = nearestDeltaR2s[ thisObjectIndex ];
+					nearestNeighbours[ newIndex ] = newIndices[ nearestNeighbours[ thisObjectIndex ] ];
+					cachedMinKts[ newIndex ] = cachedMinKts[ thisObjectIndex ];
+					floatPhis[ newIndex ] = floatPhis[ thisObjectIndex ];
+					floatRapidities[ newIndex ] = floatRapidities[ thisObjectIndex ];
+					if ( withAreas )
+					{
+						ghostCounts[ newIndex ] = ghostCounts[ thisObjectIndex ];
+						isGhostOnly[ newIndex ] = isGhostOnly[ thisObjectIndex ];
+					}
+					if ( history ) historyIndices[ newIndex ] = historyIndices[ thisObjectIndex ];
+					if ( Constituents )
+					{
+						firstConstituents[ newIndex ] = firstConstituents[ thisObjectIndex ];
+						lastConstituents[ newIndex ] = lastConstituents[ thisObjectIndex ];
+					}
+					wasDeleted[ newIndex ] = false;
+					minKts.Set( newIndex, cachedMinKts[ newIndex ] );
+				}
+
+				firstActive = totalGhosts;
+				lastActive = liveObjects;
+				m_timing.compactions++;
+				m_timing.compactionTime += tbb::tick_count::now() - startCompactionTime;
+				m_timing.counters.EndPhase( COMPACTION_PHASE, startCompactionEvents );
+				if ( COUNTERS ) bytesTouched += ( liveObjects - totalGhosts ) * ( ( 9 * sizeof( double ) ) + ( 2 * sizeof( float ) ) + sizeof( unsigned int ) + sizeof( bool ) );
+			};
+
+			//The kt^2 an object would have with its nearest neighbour, or alone
+			auto updateKt2 = [&]( unsigned int thisObjectIndex )
+			{
+				unsigned int const neighbour = nearestNeighbours[ thisObjectIndex ];
+				double const thisWeight = weights[ thisObjectIndex ];
+				double kt2 = thisWeight;
+				if ( neighbour != thisObjectIndex )
+				{
+					double const pairKt2 = nearestDeltaR2s[ thisObjectIndex ] * m_radius.InverseR2() * Algorithm::PairWeight( thisWeight, weights[ neighbour ] );
+					if ( pairKt2 < kt2 ) kt2 = pairKt2;
+				}
+				cachedMinKts[ thisObjectIndex ] = kt2;
+				markStale( thisObjectIndex );
+			};
+
+			//Find the nearest neighbour of an object from all active objects
+			//The kernels search either side of the object, or all of the active range for a ghost,
+			//and then the ghosts are searched from the grid
+			auto findNeighbour = [&]( unsigned int thisObjectIndex )
+			{
+				//No partner yet
+				double minDeltaR2 = DBL_MAX;
+				unsigned int minDeltaR2Pair = thisObjectIndex;
+				unsigned int const splitIndex = std::max( thisObjectIndex, firstActive );
+				unsigned int const afterIndex = std::max( thisObjectIndex + 1, firstActive );
+
+				//Try single precision first, and only accept a clear winner
+				bool found = false;
+				if ( m_options.singlePrecision )
+				{
+					float minFloatDeltaR2 = FLT_MAX;
+					float secondFloatDeltaR2 = FLT_MAX;
+					unsigned int minFloatPair = thisObjectIndex;
+					m_options.floatKernel( floatPhis[ thisObjectIndex ], floatRapidities[ thisObjectIndex ], floatPhis, floatRapidities, wasDeleted,
+							firstActive, splitIndex, minFloatDeltaR2, secondFloatDeltaR2, minFloatPair );
+					m_options.floatKernel( floatPhis[ thisObjectIndex ], floatRapidities[ thisObjectIndex ], floatPhis, floatRapidities, wasDeleted,
+							afterIndex, lastActive, minFloatDeltaR2, secondFloatDeltaR2, minFloatPair );
+
+					if ( minFloatPair == thisObjectIndex )
+					{
+						found = true;
+					}
+					else if ( secondFloatDeltaR2 == FLT_MAX || double( secondFloatDeltaR2 ) - double( minFloatDeltaR2 ) >
+							FloatDeltaR2Error( minFloatDeltaR2, coordinateScale ) + FloatDeltaR2Error( secondFloatDeltaR2, coordinateScale ) )
+					{
+						minDeltaR2 = DeltaR2( phis[ thisObjectIndex ], rapidities[ thisObjectIndex ], phis[ minFloatPair ], rapidities[ minFloatPair ] );
+						minDeltaR2Pair = minFloatPair;
+						found = true;
+					}
+					else
+					{
+						doublePrecisionRechecks++;
+					}
+				}
+
+				//Create pairs either side of this object
+				if ( !found )
+				{
+					m_options.kernel( phis[ thisObjectIndex ], rapidities[ thisObjectIndex ], phis, rapidities, wasDeleted,
+							firstActive, splitIndex, minDeltaR2, minDeltaR2Pair );
+					m_options.kernel( phis[ thisObjectIndex ], rapidities[ thisObjectIndex ], phis, rapidities, wasDeleted,
+							afterIndex, lastActive, minDeltaR2, minDeltaR2Pair );
+				}
+
+				//Ghosts have lower indices, so they win a tie
+				unsigned long ghostPairs = 0;
+				if ( liveGhosts )
+				{
+					ghostPairs = Ghosts->NearestGhost( phis[ thisObjectIndex ], rapidities[ thisObjectIndex ], phis, rapidities, wasDeleted, thisObjectIndex,
+							DeltaR2, minDeltaR2, minDeltaR2Pair );
+				}
+
+				if ( COUNTERS )
+				{
+					unsigned long const pairs = ( splitIndex - firstActive ) + ( lastActive - afterIndex );
+					unsigned long const floatPairs = m_options.singlePrecision ? pairs : 0;
+					unsigned long const doublePairs = found ? 0 : pairs;
+					neighbourSearches.fetch_add( 1, std::memory_order_relaxed );
+					pairsEvaluated.fetch_add( floatPairs + doublePairs + ghostPairs, std::memory_order_relaxed );
+					bytesTouched.fetch_add( ( floatPairs * ( ( 2 * sizeof( float ) ) + sizeof( bool ) ) ) + ( ( doublePairs + ghostPairs ) * ( ( 2 * sizeof( double ) ) + sizeof( bool ) ) ),
+							std::memory_order_relaxed );
+				}
+
+				//Store nearest neighbour
+				nearestDeltaR2s[ thisObjectIndex ] = minDeltaR2;
+				nearestNeighbours[ thisObjectIndex ] = minDeltaR2Pair;
+				updateKt2( thisObjectIndex );
+			};
+
+			//Bring an object's nearest neighbour up to date after a merge into MergedIndex, or a jet, which
+			//removed RemovedIndex and OtherRemovedIndex. Objects that lost their neighbour need a full search,
+			//every other object only has to check whether the merged object is now closer.
+			auto updateObject = [&]( unsigned int thisObjectIndex, bool IsMerge, unsigned int MergedIndex, unsigned int RemovedIndex, unsigned int OtherRemovedIndex )
+			{
+				if ( wasDeleted[ thisObjectIndex ] || thisObjectIndex == MergedIndex ) return;
+
+				unsigned int const neighbour = nearestNeighbours[ thisObjectIndex ];
+				if ( neighbour == RemovedIndex || neighbour == OtherRemovedIndex )
+				{
+					findNeighbour( thisObjectIndex );
+				}
+				else if ( IsMerge )
+				{
+					double const mergedDeltaR2 = DeltaR2( phis[ thisObjectIndex ], rapidities[ thisObjectIndex ], phis[ MergedIndex ], rapidities[ MergedIndex ] );
+					if ( neighbour == MergedIndex )
+					{
+						//Still the nearest if it got closer, otherwise something else might be
+						if ( mergedDeltaR2 <= nearestDeltaR2s[ thisObjectIndex ] )
+						{
+							nearestDeltaR2s[ thisObjectIndex ] = mergedDeltaR2;
+							updateKt2( thisObjectIndex );
+						}
+						else
+						{
+							findNeighbour( thisObjectIndex );
+						}
+					}
+					else if ( mergedDeltaR2 < nearestDeltaR2s[ thisObjectIndex ] )
+					{
+						nearestDeltaR2s[ thisObjectIndex ] = mergedDeltaR2;
+						nearestNeighbours[ thisObjectIndex ] = MergedIndex;
+						updateKt2( thisObjectIndex );
+					}
+				}
+			};
+
+			//Take an object out of the clustering
+			auto remove = [&]( unsigned int thisObjectIndex )
+			{
+				wasDeleted[ thisObjectIndex ] = true;
+				cachedMinKts[ thisObjectIndex ] = DBL_MAX;
+				markStale( thisObjectIndex );
+				if ( thisObjectIndex < totalGhosts ) liveGhosts--;
+			};
+
+			//Make the jets
+			tbb::tick_count const startTime = tbb::tick_count::now();
+
+			//Initial neighbours
+			tbb::tick_count const startInitialKtTime = tbb::tick_count::now();
+			PerfSample startInitialEvents;
+			m_timing.counters.StartPhase( startInitialEvents );
+			//Only the kt^2 to work out if the neighbours came with the input, which can't know about ghosts
+			if ( !totalGhosts && LoadNeighbours( Inputs, nearestDeltaR2s, nearestNeighbours ) ) forEachObject( 0, totalObjects, updateKt2 );
+			else forEachObject( 0, totalObjects, findNeighbour );
+			for ( unsigned int thisObjectIndex = 0; thisObjectIndex < totalGhosts; thisObjectIndex++ ) maxGhostDeltaR2 = std::max( maxGhostDeltaR2, nearestDeltaR2s[ thisObjectIndex ] );
+			m_timing.findMinKtTime += tbb::tick_count::now() - startInitialKtTime;
+			m_timing.counters.EndPhase( NEIGHBOUR_PHASE, startInitialEvents );
+			updateHeap();
+
+			double const cellArea = Ghosts ? Ghosts->CellArea() : 0.0;
+			unsigned int activeObjects = totalObjects;
+			while( activeObjects )
+			{
+				//Min kt^2 value over all objects, the lowest index on a tie like a linear scan
+				tbb::tick_count const startKtTime = tbb::tick_count::now();
+				PerfSample startKtEvents;
+				m_timing.counters.StartPhase( startKtEvents );
+				unsigned int const thisMinIndex = minKts.Top();
+				double const overallMinKt2 = minKts.TopKey();
+
+				//Beam distance wins if it is no larger than the pair distance
+				unsigned int pairMinIndex = nearestNeighbours[ thisMinIndex ];
+				if ( overallMinKt2 == weights[ thisMinIndex ] ) pairMinIndex = thisMinIndex;
+				m_timing.findMinKtTime += tbb::tick_count::now() - startKtTime;
+				m_timing.counters.EndPhase( MIN_KT_PHASE, startKtEvents );
+
+				//Single objects as min kt are outputs, pairs get merged
+				tbb::tick_count const startUpdateTime = tbb::tick_count::now();
+				PerfSample startUpdateEvents;
+				m_timing.counters.StartPhase( startUpdateEvents );
+				bool const isMerge = ( thisMinIndex != pairMinIndex );
+				unsigned int const liveGhostsBefore = liveGhosts;
+				unsigned int mergedIndex = thisMinIndex;
+				unsigned int removedIndex = pairMinIndex;
+				unsigned int otherRemovedIndex = pairMinIndex;
+				double ghostDistance2 = 0.0; //furthest the merged object is from what it replaced
+				if ( COUNTERS && isMerge ) m_timing.counters.merges++;
+				if ( COUNTERS && !isMerge ) m_timing.counters.jets++;
+				if ( !isMerge )
+				{
+					//Make output jet, unless it's only ghosts
+					if ( !withAreas || !isGhostOnly[ thisMinIndex ] )
+					{
+						liveRealObjects--;
+						Outputs.push_back( FourMomentum( pxs[ thisMinIndex ], pys[ thisMinIndex ], pzs[ thisMinIndex ], energies[ thisMinIndex ] ) );
+						if ( Areas ) Areas->push_back( ghostCounts[ thisMinIndex ] * cellArea );
+						if ( Constituents )
+						{
+							for ( unsigned int object = firstConstituents[ thisMinIndex ]; object != LIST_END; object = nextConstituents[ object ] )
+							{
+								if ( object >= totalGhosts ) Constituents->Add( object - totalGhosts );
+							}
+							Constituents->EndJet();
+						}
+					}
+
+					//Remove jet from active data
+					if ( history ) history->AddBeam( historyIndices[ thisMinIndex ], overallMinKt2 );
+					remove( thisMinIndex );
+				}
+				else
+				{
+					//A ghost never holds a merge: it goes to the other object, or after everything else for two ghosts
+					if ( thisMinIndex < totalGhosts && pairMinIndex < totalGhosts )
+					{
+						mergedIndex = lastActive++;
+						removedIndex = thisMinIndex;
+						wasDeleted[ mergedIndex ] = false;
+						isStale[ mergedIndex ] = false;
+						wasRefreshed[ mergedIndex ] = false;
+					}
+					else if ( thisMinIndex < totalGhosts )
+					{
+						mergedIndex = pairMinIndex;
+						removedIndex = thisMinIndex;
+						otherRemovedIndex = thisMinIndex;
+					}
+
+					//Where the objects were, for the ghosts that had them as nearest neighbours
+					double const thisPhi = phis[ thisMinIndex ];
+					double const thisRapidity = rapidities[ thisMinIndex ];
+					double const pairPhi = phis[ pairMinIndex ];
+					double const pairRapidity = rapidities[ pairMinIndex ];
+
+					//The merge replaces one of the objects unless two ghosts merged, its kinematics from the same kernel as the inputs
+					pxs[ mergedIndex ] = pxs[ thisMinIndex ] + pxs[ pairMinIndex ];
+					pys[ mergedIndex ] = pys[ thisMinIndex ] + pys[ pairMinIndex ];
+					pzs[ mergedIndex ] = pzs[ thisMinIndex ] + pzs[ pairMinIndex ];
+					energies[ mergedIndex ] = energies[ thisMinIndex ] + energies[ pairMinIndex ];
+					m_options.kinematics( pxs, pys, pzs, energies, mergedIndex, mergedIndex + 1, weights, rapidities, phis );
+					weights[ mergedIndex ] = m_algorithm.Weight( weights[ mergedIndex ] );
+					floatPhis[ mergedIndex ] = phis[ mergedIndex ];
+					floatRapidities[ mergedIndex ] = rapidities[ mergedIndex ];
+					coordinateScale = std::max( coordinateScale, fabs( rapidities[ mergedIndex ] ) );
+					if ( withAreas )
+					{
+						if ( !isGhostOnly[ thisMinIndex ] && !isGhostOnly[ pairMinIndex ] ) liveRealObjects--;
+						ghostCounts[ mergedIndex ] = ghostCounts[ thisMinIndex ] + ghostCounts[ pairMinIndex ];
+						isGhostOnly[ mergedIndex ] = isGhostOnly[ thisMinIndex ] && isGhostOnly[ pairMinIndex ];
+					}
+					if ( Constituents )
+					{
+						unsigned int const first = firstConstituents[ thisMinIndex ];
+						unsigned int const last = lastConstituents[ pairMinIndex ];
+						nextConstituents[ lastConstituents[ thisMinIndex ] ] = firstConstituents[ pairMinIndex ];
+						firstConstituents[ mergedIndex ] = first;
+						lastConstituents[ mergedIndex ] = last;
+					}
+					if ( history )
+					{
+						historyIndices[ mergedIndex ] = history->AddMerge( historyIndices[ thisMinIndex ], historyIndices[ pairMinIndex ], overallMinKt2,
+								FourMomentum( pxs[ mergedIndex ], pys[ mergedIndex ], pzs[ mergedIndex ], energies[ mergedIndex ] ) );
+					}
+
+					if ( liveGhosts )
+					{
+						ghostDistance2 = std::max( DeltaR2( thisPhi, thisRapidity, phis[ mergedIndex ], rapidities[ mergedIndex ] ),
+								DeltaR2( pairPhi, pairRapidity, phis[ mergedIndex ], rapidities[ mergedIndex ] ) );
+					}
+
+					//Remove what was merged
+					remove( removedIndex );
+					if ( otherRemovedIndex != removedIndex ) remove( otherRemovedIndex );
+				}
+
+				//Reduce the search ranges
+				while ( firstActive < lastActive && wasDeleted[ firstActive ] ) firstActive++;
+				while ( lastActive > firstActive && wasDeleted[ lastActive - 1 ] ) lastActive--;
+
+				if ( isMerge ) findNeighbour( mergedIndex );
+				unsigned long const searchesBefore = COUNTERS ? neighbourSearches.load() : 0;
+				forEachObject( firstActive, lastActive, [&]( unsigned int thisObjectIndex )
+				{
+					updateObject( thisObjectIndex, isMerge, mergedIndex, removedIndex, otherRemovedIndex );
+				} );
+
+				//Only ghosts within the furthest any ghost is from its nearest neighbour can be affected
+				unsigned long ghostChecks = 0;
+				if ( liveGhosts )
+				{
+					double const ghostSearchRadius = sqrt( maxGhostDeltaR2 ) + sqrt( ghostDistance2 );
+					Ghosts->ForEachGhostNear( phis[ mergedIndex ], rapidities[ mergedIndex ], ghostSearchRadius, [&]( unsigned int thisObjectIndex )
+					{
+						if ( wasDeleted[ thisObjectIndex ] ) return;
+						if ( COUNTERS ) ghostChecks++;
+						updateObject( thisObjectIndex, isMerge, mergedIndex, removedIndex, otherRemovedIndex );
+						maxGhostDeltaR2 = std::max( maxGhostDeltaR2, nearestDeltaR2s[ thisObjectIndex ] );
+					} );
+				}
+
+				//Every other live object past the ghosts was checked, and one that didn't need a search is a hit
+				if ( COUNTERS )
+				{
+					unsigned long const involved = ( thisMinIndex >= totalGhosts ) + ( isMerge && pairMinIndex >= totalGhosts );
+					unsigned long const checks = ( activeObjects - liveGhostsBefore ) - involved + ghostChecks;
+					m_timing.counters.cacheChecks += checks;
+					m_timing.counters.cacheHits += checks - ( neighbourSearches.load() - searchesBefore );
+					if ( isMerge ) pairsEvaluated += checks;
+				}
+
+				activeObjects--;
+				m_timing.updateCollectionsTime += tbb::tick_count::now() - startUpdateTime;
+				m_timing.counters.EndPhase( UPDATE_PHASE, startUpdateEvents );
+				updateHeap();
+
+				//Once every real particle is in a jet, all that's left would be jets of only ghosts
+				if ( withAreas && !liveRealObjects ) break;
+
+				//Squeeze out the holes if there are too many
+				if ( activeObjects && activeObjects - liveGhosts < m_options.compactionThreshold * double( lastActive - firstActive ) ) compact();
+			}
+			m_timing.totalTime += tbb::tick_count::now() - startTime;
+			m_timing.doublePrecisionRechecks += doublePrecisionRechecks;
+			if ( COUNTERS )
+			{
+				m_timing.counters.pairsEvaluated += pairsEvaluated;
+				m_timing.counters.neighbourSearches += neighbourSearches;
+				m_timing.counters.bytesTouched += bytesTouched;
+			}
+		}
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef EVENT_READER_H
+#define EVENT_READER_H
+
+#include <string>
+#include <istream>
+#include <cstdlib>
+
+#include "ParticleArrays.h"
+
+//Text events as in the fastjet examples: one "px py pz E" line per particle, and a line starting
+//with #END after each event. The last event can just stop at the end of the file, so a single event
+//file is read as before. Other lines starting with # and blank lines are ignored.
+//Returns false once there are no more events.
+inline bool ReadEvent( std::istream & Input, ParticleArrays & Particles )
+{
+	Particles.clear();
+	bool sawAnything = false;
+	std::string line;
+	while ( std::getline( Input, line ) )
+	{
+		if ( line.compare( 0, 4, "#END" ) == 0 ) return true;
+		if ( line.empty() || line[ 0 ] == '#' ) continue;
+
+		char const * cursor = line.c_str();
+		char * end;
+		double momentum[ 4 ];
+		unsigned int values = 0;
+		for ( ; values < 4; values++ )
+		{
+			momentum[ values ] = strtod( cursor, &end );
+			if ( end == cursor ) break;
+			cursor = end;
+		}
+		if ( values < 4 ) continue;
+
+		Particles.push_back( momentum[ 0 ], momentum[ 1 ], momentum[ 2 ], momentum[ 3 ] );
+		sawAnything = true;
+	}
+	return sawAnything;
+}
+
+#endif
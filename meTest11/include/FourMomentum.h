@@ -0,0 +1,91 @@
+#ifndef FOUR_MOMENTUM_H
+#define FOUR_MOMENTUM_H
+
+#include <cmath>
+
+//Plain four-momentum, standing in for TLorentzVector so nothing here needs ROOT
+//Same accessor names, and the kinematics are worked out the same way, so the jets are identical.
+//No virtual functions: it's four doubles, trivially copyable, and constexpr where the maths allows.
+class FourMomentum
+{
+	public:
+		constexpr FourMomentum( double Px = 0.0, double Py = 0.0, double Pz = 0.0, double E = 0.0 ) : m_px( Px ), m_py( Py ), m_pz( Pz ), m_E( E )
+		{
+		}
+
+		void SetPxPyPzE( double Px, double Py, double Pz, double E )
+		{
+			m_px = Px;
+			m_py = Py;
+			m_pz = Pz;
+			m_E = E;
+		}
+
+		constexpr double Px() const
+		{
+			return m_px;
+		}
+		constexpr double Py() const
+		{
+			return m_py;
+		}
+		constexpr double Pz() const
+		{
+			return m_pz;
+		}
+		constexpr double E() const
+		{
+			return m_E;
+		}
+
+		constexpr double Perp2() const
+		{
+			return ( m_px * m_px ) + ( m_py * m_py );
+		}
+		double Pt() const
+		{
+			return std::sqrt( this->Perp2() );
+		}
+
+		//-pi to pi, 0 along the beam
+		double Phi() const
+		{
+			return ( m_px == 0.0 && m_py == 0.0 ) ? 0.0 : std::atan2( m_py, m_px );
+		}
+		double Rapidity() const
+		{
+			return 0.5 * std::log( ( m_E + m_pz ) / ( m_E - m_pz ) );
+		}
+
+		//Negative for spacelike vectors, like ROOT
+		constexpr double M2() const
+		{
+			return ( m_E * m_E ) - ( ( m_px * m_px ) + ( m_py * m_py ) + ( m_pz * m_pz ) );
+		}
+		double M() const
+		{
+			double const m2 = this->M2();
+			return m2 < 0.0 ? -std::sqrt( -m2 ) : std::sqrt( m2 );
+		}
+
+		constexpr FourMomentum operator+( FourMomentum const& Other ) const
+		{
+			return FourMomentum( m_px + Other.m_px, m_py + Other.m_py, m_pz + Other.m_pz, m_E + Other.m_E );
+		}
+		FourMomentum & operator+=( FourMomentum const& Other )
+		{
+			m_px += Other.m_px;
+			m_py += Other.m_py;
+			m_pz += Other.m_pz;
+			m_E += Other.m_E;
+			return *this;
+		}
+
+	private:
+		double m_px;
+		double m_py;
+		double m_pz;
+		double m_E;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef GHOST_GRID_H
+#define GHOST_GRID_H
+
+#include <cmath>
+#include <algorithm>
+
+//Ghosts for active jet areas: one very soft particle in the middle of each cell of a grid in rapidity
+//and phi, covering |y| < MaxRapidity. Clustered with the real particles, a jet's area is the number of
+//ghosts it picks up times the cell area. The ghost pT is small enough that adding it never changes
+//a real jet's momentum, and big enough that pT^2p doesn't overflow for the usual p.
+//Ghost i is row i / phiCells, column i % phiCells, so where ghosts are and how far apart is known
+//without looking at them.
+struct GhostGrid
+{
+	double maxRapidity;
+	double ghostPt;
+	unsigned int rapidityCells;
+	unsigned int phiCells;
+	double rapiditySpacing;
+	double phiSpacing;
+
+	//No ghosts with the default MaxRapidity of 0. The cells are as square as they can be while
+	//fitting the grid exactly, so their area is a little under GhostArea.
+	GhostGrid( double MaxRapidity = 0.0, double GhostArea = 0.005, double GhostPt = 1e-45 ) : maxRapidity( MaxRapidity ), ghostPt( GhostPt ),
+		rapidityCells( 0 ), phiCells( 0 ), rapiditySpacing( 0.0 ), phiSpacing( 0.0 )
+	{
+		if ( MaxRapidity <= 0.0 || GhostArea <= 0.0 ) return;
+		double const side = sqrt( GhostArea );
+		rapidityCells = ( unsigned int )ceil( 2.0 * MaxRapidity / side );
+		phiCells = ( unsigned int )ceil( 2.0 * M_PI / side );
+		rapiditySpacing = 2.0 * MaxRapidity / rapidityCells;
+		phiSpacing = 2.0 * M_PI / phiCells;
+	}
+
+	unsigned int size() const
+	{
+		return rapidityCells * phiCells;
+	}
+	double CellArea() const
+	{
+		return rapiditySpacing * phiSpacing;
+	}
+
+	//Where a ghost is, phi in [-pi, pi] like the kinematics kernels
+	double Rapidity( unsigned int Ghost ) const
+	{
+		return -maxRapidity + ( ( ( Ghost / phiCells ) + 0.5 ) * rapiditySpacing );
+	}
+	double Phi( unsigned int Ghost ) const
+	{
+		return -M_PI + ( ( ( Ghost % phiCells ) + 0.5 ) * phiSpacing );
+	}
+
+	//Massless four-momentum of a ghost
+	void Momentum( unsigned int Ghost, double & Px, double & Py, double & Pz, double & E ) const
+	{
+		double const rapidity = this->Rapidity( Ghost );
+		double const phi = this->Phi( Ghost );
+		Px = ghostPt * cos( phi );
+		Py = ghostPt * sin( phi );
+		Pz = ghostPt * sinh( rapidity );
+		E = ghostPt * cosh( rapidity );
+	}
+
+	//Cell containing a point, clamped to the grid in rapidity and wrapped in phi
+	//Written so that a NaN, from an unphysical input, still gives a cell on the grid
+	int RapidityCell( double Rapidity ) const
+	{
+		double const cell = floor( ( Rapidity + maxRapidity ) / rapiditySpacing );
+		if ( !( cell >= 0.0 ) ) return 0;
+		return cell < rapidityCells ? ( int )cell : rapidityCells - 1;
+	}
+	int PhiCell( double Phi ) const
+	{
+		double const position = floor( ( Phi + M_PI ) / phiSpacing );
+		if ( !( fabs( position ) < 1e9 ) ) return 0;
+		int const cell = ( int )position % ( int )phiCells;
+		return cell < 0 ? cell + phiCells : cell;
+	}
+
+	//Every ghost in the cells that could be within Radius of a point, each visited once
+	template< class Visit >
+	void ForEachGhostNear( double Phi, double Rapidity, double Radius, Visit const& F ) const
+	{
+		//Anything not finite, such as the infinite rapidity of a particle along the beam, covers the whole grid
+		bool const everywhere = !std::isfinite( Rapidity ) || !std::isfinite( Phi ) || !( Radius < 1e9 );
+		int const firstRow = everywhere ? 0 : this->RapidityCell( Rapidity - Radius - rapiditySpacing );
+		int const lastRow = everywhere ? rapidityCells - 1 : this->RapidityCell( Rapidity + Radius + rapiditySpacing );
+		int const columnCentre = this->PhiCell( Phi );
+		double const halfWidth = ceil( Radius / phiSpacing ) + 1.0;
+		bool const allColumns = everywhere || ( 2.0 * halfWidth ) + 1.0 >= phiCells;
+		int const firstColumn = allColumns ? 0 : columnCentre - ( int )halfWidth;
+		int const lastColumn = allColumns ? phiCells - 1 : columnCentre + ( int )halfWidth;
+		for ( int row = firstRow; row <= lastRow; row++ )
+		{
+			for ( int column = firstColumn; column <= lastColumn; column++ )
+			{
+				int const wrapped = column < 0 ? column + phiCells : column >= ( int )phiCells ? column - phiCells : column;
+				F( ( row * phiCells ) + wrapped );
+			}
+		}
+	}
+
+	//Nearest live ghost to a point other than Skip, by delta_R^2 worked out exactly as DeltaR2 does,
+	//so the answer is the same as checking every ghost. Searches outwards from the point's cell one
+	//ring of cells at a time, and stops once nothing in the next ring could be as close as the best so far.
+	//MinDeltaR2 and MinIndex are only changed by a ghost that is closer, or as close with a lower index.
+	//Returns the number of ghosts looked at.
+	template< class Distance >
+	unsigned int NearestGhost( double Phi, double Rapidity, double const * Phis, double const * Rapidities, bool const * WasDeleted, unsigned int Skip,
+			Distance const& DeltaR2, double & MinDeltaR2, unsigned int & MinIndex ) const
+	{
+		int const row = this->RapidityCell( Rapidity );
+		int const column = this->PhiCell( Phi );
+		int const lowestRow = -row;
+		int const highestRow = rapidityCells - 1 - row;
+		int const lowestColumn = -( ( ( int )phiCells - 1 ) / 2 );
+		int const highestColumn = phiCells / 2;
+		int const lastRing = std::max( std::max( -lowestRow, highestRow ), std::max( -lowestColumn, highestColumn ) );
+		double const minSpacing = std::min( rapiditySpacing, phiSpacing );
+
+		unsigned int looked = 0;
+		auto tryCell = [&]( int RowOffset, int ColumnOffset )
+		{
+			int wrapped = column + ColumnOffset;
+			if ( wrapped < 0 ) wrapped += phiCells;
+			else if ( wrapped >= ( int )phiCells ) wrapped -= phiCells;
+			unsigned int const ghost = ( ( row + RowOffset ) * phiCells ) + wrapped;
+			if ( ghost == Skip || WasDeleted[ ghost ] ) return;
+			looked++;
+			double const deltaR2 = DeltaR2( Phi, Rapidity, Phis[ ghost ], Rapidities[ ghost ] );
+			if ( deltaR2 < MinDeltaR2 || ( deltaR2 == MinDeltaR2 && ghost < MinIndex ) )
+			{
+				MinDeltaR2 = deltaR2;
+				MinIndex = ghost;
+			}
+		};
+
+		for ( int ring = 0; ring <= lastRing; ring++ )
+		{
+			//Every ghost in this ring is at least ring - 1/2 cells away, less a margin for rounding
+			double const bound = ( ring - 0.5 ) * minSpacing * ( 1.0 - 1e-9 );
+			if ( ring > 0 && bound * bound > MinDeltaR2 ) break;
+
+			int const firstColumn = std::max( -ring, lowestColumn );
+			int const lastColumn = std::min( ring, highestColumn );
+			for ( int rowOffset = std::max( -ring, lowestRow ); rowOffset <= std::min( ring, highestRow ); rowOffset++ )
+			{
+				if ( rowOffset == -ring || rowOffset == ring )
+				{
+					for ( int columnOffset = firstColumn; columnOffset <= lastColumn; columnOffset++ ) tryCell( rowOffset, columnOffset );
+				}
+				else
+				{
+					if ( -ring >= lowestColumn ) tryCell( rowOffset, -ring );
+					if ( ring <= highestColumn && ring != 0 ) tryCell( rowOffset, ring );
+				}
+			}
+		}
+		return looked;
+	}
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef JET_CONSTITUENTS_H
+#define JET_CONSTITUENTS_H
+
+#include <vector>
+#include <algorithm>
+
+//Which inputs went into each jet of an event, all in two flat arrays: the inputs of jet j are
+//indices[ offsets[ j ] ] up to indices[ offsets[ j + 1 ] ], as positions in the clusterer's input.
+//Clearing keeps the memory, so one reused for every event stops allocating after the biggest.
+struct JetConstituents
+{
+	std::vector< unsigned int > offsets;
+	std::vector< unsigned int > indices;
+
+	JetConstituents() : offsets( 1, 0 )
+	{
+	}
+
+	void Clear()
+	{
+		offsets.resize( 1 );
+		indices.clear();
+	}
+	//Room for this many more, growing by at least double so adding event after event stays cheap
+	void Reserve( unsigned int Jets, unsigned int Inputs )
+	{
+		if ( offsets.capacity() < offsets.size() + Jets ) offsets.reserve( std::max( offsets.size() + Jets, 2 * offsets.capacity() ) );
+		if ( indices.capacity() < indices.size() + Inputs ) indices.reserve( std::max( indices.size() + Inputs, 2 * indices.capacity() ) );
+	}
+
+	unsigned int size() const
+	{
+		return offsets.size() - 1;
+	}
+	unsigned int Count( unsigned int Jet ) const
+	{
+		return offsets[ Jet + 1 ] - offsets[ Jet ];
+	}
+	unsigned int const * Begin( unsigned int Jet ) const
+	{
+		return indices.data() + offsets[ Jet ];
+	}
+	unsigned int const * End( unsigned int Jet ) const
+	{
+		return indices.data() + offsets[ Jet + 1 ];
+	}
+
+	//Replace every index with Positions[ index ], such as to go from the sorted copy that was clustered
+	//back to the order the inputs were read in
+	void Renumber( unsigned int const * Positions )
+	{
+		for ( unsigned int i = 0; i < indices.size(); i++ ) indices[ i ] = Positions[ indices[ i ] ];
+	}
+
+	//Filling in: the inputs of a jet, then the end of it
+	void Add( unsigned int Input )
+	{
+		indices.push_back( Input );
+	}
+	void EndJet()
+	{
+		offsets.push_back( indices.size() );
+	}
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef JET_VALIDATION_H
+#define JET_VALIDATION_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#include "FourMomentum.h"
+
+//One row of the fastjet demo jet table, and the area if the table has them
+struct ReferenceJet
+{
+	double rapidity;
+	double phi;
+	double pt;
+	double area;
+};
+
+//Read the jet table from fastjet demo output, everything before the "jet #" header is skipped
+//A fifth column is the area, otherwise it's 0
+inline void ReadJetTable( std::istream & Input, std::vector< ReferenceJet > & Jets )
+{
+	bool inTable = false;
+	std::string line;
+	while ( std::getline( Input, line ) )
+	{
+		if ( !inTable )
+		{
+			inTable = ( line.compare( 0, 5, "jet #" ) == 0 );
+			continue;
+		}
+
+		std::istringstream row( line );
+		unsigned int jetIndex;
+		ReferenceJet jet;
+		if ( !( row >> jetIndex >> jet.rapidity >> jet.phi >> jet.pt ) ) continue;
+		if ( !( row >> jet.area ) ) jet.area = 0.0;
+		Jets.push_back( jet );
+	}
+}
+
+//The same from a file, returns false if it can't be opened
+inline bool ReadReferenceJets( std::string const& FileName, std::vector< ReferenceJet > & Jets )
+{
+	std::ifstream input( FileName.c_str() );
+	if ( !input.is_open() ) return false;
+	ReadJetTable( input, Jets );
+	return true;
+}
+
+//A jet as a table row, phi in [0, 2pi) like fastjet prints it
+inline ReferenceJet JetRow( FourMomentum const& Jet, double Area = 0.0 )
+{
+	ReferenceJet row;
+	row.rapidity = Jet.Rapidity();
+	row.phi = Jet.Phi();
+	while ( row.phi < 0.0 ) row.phi += 2.0 * M_PI;
+	row.pt = Jet.Pt();
+	row.area = Area;
+	return row;
+}
+
+//Compare jets sorted pT high to low with a reference table, printing every difference
+//The reference may stop at a pT cut, so only that many jets are compared, but a jet of ours above
+//the softest reference jet with no counterpart is also a difference. The table is printed to
+//8 decimal places, which sets the tolerance, except that rapidity is looser since E - pz cancels
+//badly for very forward jets. Differences are printed to Log, and the number of them returned.
+inline unsigned int CompareJetTables( std::vector< ReferenceJet > const& Jets, std::vector< ReferenceJet > const& Reference, FILE * Log = stdout )
+{
+	double const TWO_PI = 2.0 * M_PI;
+	double const TOLERANCE = 1e-6;
+	double const RAPIDITY_TOLERANCE = 1e-5;
+	unsigned int differences = 0;
+
+	for ( unsigned int jetIndex = 0; jetIndex < Reference.size(); jetIndex++ )
+	{
+		ReferenceJet const& expected = Reference[ jetIndex ];
+		if ( jetIndex >= Jets.size() )
+		{
+			fprintf( Log, "Jet %u missing: expected %15.8f %15.8f %15.8f\n", jetIndex, expected.rapidity, expected.phi, expected.pt );
+			differences++;
+			continue;
+		}
+
+		double const phi = Jets[ jetIndex ].phi;
+		double const rapidity = Jets[ jetIndex ].rapidity;
+		double const pt = Jets[ jetIndex ].pt;
+
+		double deltaPhi = fabs( phi - expected.phi );
+		deltaPhi = std::min( deltaPhi, TWO_PI - deltaPhi );
+		if ( fabs( rapidity - expected.rapidity ) > RAPIDITY_TOLERANCE * std::max( 1.0, fabs( expected.rapidity ) )
+				|| deltaPhi > TOLERANCE
+				|| fabs( pt - expected.pt ) > TOLERANCE * std::max( 1.0, expected.pt ) )
+		{
+			fprintf( Log, "Jet %u differs: got %15.8f %15.8f %15.8f, expected %15.8f %15.8f %15.8f\n", jetIndex,
+					rapidity, phi, pt, expected.rapidity, expected.phi, expected.pt );
+			differences++;
+		}
+	}
+
+	//Extra hard jets
+	double const softestReference = Reference.empty() ? 0.0 : Reference.back().pt;
+	for ( unsigned int jetIndex = Reference.size(); jetIndex < Jets.size(); jetIndex++ )
+	{
+		if ( Jets[ jetIndex ].pt <= softestReference * ( 1.0 + TOLERANCE ) ) break;
+		fprintf( Log, "Jet %u unexpected: pt %15.8f\n", jetIndex, Jets[ jetIndex ].pt );
+		differences++;
+	}
+
+	return differences;
+}
+
+//The same for clustered jets
+inline unsigned int CompareWithReference( std::vector< FourMomentum > const& Jets, std::vector< ReferenceJet > const& Reference, FILE * Log = stdout )
+{
+	std::vector< ReferenceJet > rows;
+	rows.reserve( Jets.size() );
+	for ( unsigned int jetIndex = 0; jetIndex < Jets.size(); jetIndex++ ) rows.push_back( JetRow( Jets[ jetIndex ] ) );
+	return CompareJetTables( rows, Reference, Log );
+}
+
+#endif
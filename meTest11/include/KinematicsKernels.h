@@ -0,0 +1,371 @@
+#ifndef KINEMATICS_KERNELS_H
+#define KINEMATICS_KERNELS_H
+
+#include <string>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include <immintrin.h>
+
+#include "FourMomentum.h"
+
+//pT^2, rapidity and phi of a range of objects from their four-momenta, written to the same index.
+//"exact" uses libm through FourMomentum. The others use the log and atan2 below, which are plain
+//adds, multiplies and divides so the scalar, AVX2 and AVX-512 versions give bit for bit the same
+//answer. Checked against libm over 10^7 random momenta: log within 1 ulp, atan2 within 2 ulp, so
+//rapidity and phi are within 2 ulp of the exact kernel. Build with -ffp-contract=off, as for the
+//neighbour kernels. Merged objects go through the same kernel with a range of one.
+typedef void ( *KinematicsKernel )( double const * Pxs, double const * Pys, double const * Pzs, double const * Energies,
+		unsigned int Begin, unsigned int End,
+		double * Perp2s, double * Rapidities, double * Phis );
+
+namespace KinematicsConstants
+{
+	//fdlibm log: log( 1 + f ) = 2s + s R( s^2 ), s = f / ( 2 + f ), with 1 + f in [sqrt( 1/2 ), sqrt( 2 ))
+	double const LN2_HI = 6.93147180369123816490e-01;
+	double const LN2_LO = 1.90821492927058770002e-10;
+	double const LG1 = 6.666666666666735130e-01;
+	double const LG2 = 3.999999999940941908e-01;
+	double const LG3 = 2.857142874366239149e-01;
+	double const LG4 = 2.222219843214978396e-01;
+	double const LG5 = 1.818357216161805012e-01;
+	double const LG6 = 1.531383769920937332e-01;
+	double const LG7 = 1.479819860511658591e-01;
+	//Moves the exponent boundary from 1 to sqrt( 1/2 )
+	uint64_t const SQRT_HALF_OFFSET = 0x3ff0000000000000ULL - 0x3fe6a09e00000000ULL;
+	uint64_t const SQRT_HALF_BITS = 0x3fe6a09e00000000ULL;
+	uint64_t const MANTISSA_MASK = 0x000fffffffffffffULL;
+	//2^52, to turn a small integer in the low mantissa bits into a double
+	uint64_t const TWO_52_BITS = 0x4330000000000000ULL;
+	double const TWO_52_PLUS_BIAS = 4503599627370496.0 + 1023.0;
+
+	//Cephes atan on [0, 1]: a <= 0.66 directly, above that pi/4 + atan( ( a - 1 ) / ( a + 1 ) )
+	double const ATAN_SPLIT = 0.66;
+	double const ATAN_P0 = -8.750608600031904122785e-01;
+	double const ATAN_P1 = -1.615753718733365076637e+01;
+	double const ATAN_P2 = -7.500855792314704667340e+01;
+	double const ATAN_P3 = -1.228866684490136173410e+02;
+	double const ATAN_P4 = -6.485021904942025371773e+01;
+	double const ATAN_Q0 = 2.485846490142306297962e+01;
+	double const ATAN_Q1 = 1.650270098316988542046e+02;
+	double const ATAN_Q2 = 4.328810604912902668951e+02;
+	double const ATAN_Q3 = 4.853903996359136964868e+02;
+	double const ATAN_Q4 = 1.945506571482613964425e+02;
+	//pi/4 as a double, and what it's short by
+	double const PI_4_HI = 7.85398163397448278999e-01;
+	double const PI_4_LO = 3.06161699786838301793e-17;
+}
+
+inline double AsDouble( uint64_t Bits )
+{
+	double value;
+	memcpy( &value, &Bits, sizeof( value ) );
+	return value;
+}
+
+inline uint64_t AsBits( double Value )
+{
+	uint64_t bits;
+	memcpy( &bits, &Value, sizeof( bits ) );
+	return bits;
+}
+
+//Natural log, libm for anything that isn't a positive normal number
+inline double ApproximateLog( double X )
+{
+	using namespace KinematicsConstants;
+	if ( !( X >= DBL_MIN && X <= DBL_MAX ) ) return log( X );
+
+	uint64_t const bits = AsBits( X ) + SQRT_HALF_OFFSET;
+	double const k = AsDouble( ( bits >> 52 ) | TWO_52_BITS ) - TWO_52_PLUS_BIAS;
+	double const f = AsDouble( ( bits & MANTISSA_MASK ) + SQRT_HALF_BITS ) - 1.0;
+
+	double const halfF2 = 0.5 * f * f;
+	double const s = f / ( 2.0 + f );
+	double const z = s * s;
+	double const w = z * z;
+	double const evens = w * ( LG2 + ( w * ( LG4 + ( w * LG6 ) ) ) );
+	double const odds = z * ( LG1 + ( w * ( LG3 + ( w * ( LG5 + ( w * LG7 ) ) ) ) ) );
+	return ( s * ( halfF2 + ( odds + evens ) ) ) + ( k * LN2_LO ) - halfF2 + f + ( k * LN2_HI );
+}
+
+//atan2( Y, X ) in [-pi, pi], 0 if both are 0 like FourMomentum::Phi
+//The ratio of the smaller and larger magnitudes gives atan on [0, 1], then the octant is a multiple
+//of pi/4 added on: result = n pi/4 +- atan
+inline double ApproximateAtan2( double Y, double X )
+{
+	using namespace KinematicsConstants;
+	double const absX = fabs( X );
+	double const absY = fabs( Y );
+	if ( absX == 0.0 && absY == 0.0 ) return 0.0;
+
+	bool const swapped = ( absY > absX );
+	double const ratio = std::min( absX, absY ) / std::max( absX, absY );
+	bool const upper = ( ratio > ATAN_SPLIT );
+	double const t = upper ? ( ratio - 1.0 ) / ( ratio + 1.0 ) : ratio;
+	double const z = t * t;
+	double const numerator = ( ( ( ( ( ( ( ( ATAN_P0 * z ) + ATAN_P1 ) * z ) + ATAN_P2 ) * z ) + ATAN_P3 ) * z ) + ATAN_P4 ) * z;
+	double const denominator = ( ( ( ( ( ( ( ( z + ATAN_Q0 ) * z ) + ATAN_Q1 ) * z ) + ATAN_Q2 ) * z ) + ATAN_Q3 ) * z ) + ATAN_Q4;
+	double const arcTangent = ( t * ( numerator / denominator ) ) + t;
+
+	double octants = upper ? 1.0 : 0.0;
+	double sign = 1.0;
+	if ( swapped )
+	{
+		octants = 2.0 - octants;
+		sign = -sign;
+	}
+	if ( X < 0.0 )
+	{
+		octants = 4.0 - octants;
+		sign = -sign;
+	}
+	double const angle = ( octants * PI_4_HI ) + ( ( sign * arcTangent ) + ( octants * PI_4_LO ) );
+	return std::signbit( Y ) ? -angle : angle;
+}
+
+//Reference version, libm through FourMomentum
+inline void KinematicsExact( double const * Pxs, double const * Pys, double const * Pzs, double const * Energies,
+		unsigned int Begin, unsigned int End,
+		double * Perp2s, double * Rapidities, double * Phis )
+{
+	for ( unsigned int i = Begin; i < End; i++ )
+	{
+		FourMomentum const momentum( Pxs[ i ], Pys[ i ], Pzs[ i ], Energies[ i ] );
+		Perp2s[ i ] = momentum.Perp2();
+		Rapidities[ i ] = momentum.Rapidity();
+		Phis[ i ] = momentum.Phi();
+	}
+}
+
+//The approximations one object at a time, also does the leftovers for the SIMD versions
+inline void KinematicsScalar( double const * Pxs, double const * Pys, double const * Pzs, double const * Energies,
+		unsigned int Begin, unsigned int End,
+		double * Perp2s, double * Rapidities, double * Phis )
+{
+	for ( unsigned int i = Begin; i < End; i++ )
+	{
+		Perp2s[ i ] = ( Pxs[ i ] * Pxs[ i ] ) + ( Pys[ i ] * Pys[ i ] );
+		Rapidities[ i ] = 0.5 * ApproximateLog( ( Energies[ i ] + Pzs[ i ] ) / ( Energies[ i ] - Pzs[ i ] ) );
+		Phis[ i ] = ApproximateAtan2( Pys[ i ], Pxs[ i ] );
+	}
+}
+
+__attribute__(( target( "avx2" ) ))
+inline __m256d ApproximateLogAVX2( __m256d X )
+{
+	using namespace KinematicsConstants;
+	__m256i const bits = _mm256_add_epi64( _mm256_castpd_si256( X ), _mm256_set1_epi64x( SQRT_HALF_OFFSET ) );
+	__m256d const k = _mm256_sub_pd( _mm256_castsi256_pd( _mm256_or_si256( _mm256_srli_epi64( bits, 52 ), _mm256_set1_epi64x( TWO_52_BITS ) ) ),
+			_mm256_set1_pd( TWO_52_PLUS_BIAS ) );
+	__m256d const f = _mm256_sub_pd( _mm256_castsi256_pd( _mm256_add_epi64( _mm256_and_si256( bits, _mm256_set1_epi64x( MANTISSA_MASK ) ),
+			_mm256_set1_epi64x( SQRT_HALF_BITS ) ) ), _mm256_set1_pd( 1.0 ) );
+
+	__m256d const halfF2 = _mm256_mul_pd( _mm256_mul_pd( _mm256_set1_pd( 0.5 ), f ), f );
+	__m256d const s = _mm256_div_pd( f, _mm256_add_pd( _mm256_set1_pd( 2.0 ), f ) );
+	__m256d const z = _mm256_mul_pd( s, s );
+	__m256d const w = _mm256_mul_pd( z, z );
+	__m256d evens = _mm256_add_pd( _mm256_set1_pd( LG4 ), _mm256_mul_pd( w, _mm256_set1_pd( LG6 ) ) );
+	evens = _mm256_mul_pd( w, _mm256_add_pd( _mm256_set1_pd( LG2 ), _mm256_mul_pd( w, evens ) ) );
+	__m256d odds = _mm256_add_pd( _mm256_set1_pd( LG5 ), _mm256_mul_pd( w, _mm256_set1_pd( LG7 ) ) );
+	odds = _mm256_add_pd( _mm256_set1_pd( LG3 ), _mm256_mul_pd( w, odds ) );
+	odds = _mm256_mul_pd( z, _mm256_add_pd( _mm256_set1_pd( LG1 ), _mm256_mul_pd( w, odds ) ) );
+
+	__m256d result = _mm256_mul_pd( s, _mm256_add_pd( halfF2, _mm256_add_pd( odds, evens ) ) );
+	result = _mm256_add_pd( result, _mm256_mul_pd( k, _mm256_set1_pd( LN2_LO ) ) );
+	result = _mm256_sub_pd( result, halfF2 );
+	result = _mm256_add_pd( result, f );
+	return _mm256_add_pd( result, _mm256_mul_pd( k, _mm256_set1_pd( LN2_HI ) ) );
+}
+
+__attribute__(( target( "avx2" ) ))
+inline __m256d ApproximateAtan2AVX2( __m256d Y, __m256d X )
+{
+	using namespace KinematicsConstants;
+	__m256d const signBit = _mm256_set1_pd( -0.0 );
+	__m256d const zero = _mm256_setzero_pd();
+	__m256d const one = _mm256_set1_pd( 1.0 );
+	__m256d const absX = _mm256_andnot_pd( signBit, X );
+	__m256d const absY = _mm256_andnot_pd( signBit, Y );
+	__m256d const larger = _mm256_max_pd( absX, absY );
+	__m256d const bothZero = _mm256_cmp_pd( larger, zero, _CMP_EQ_OQ );
+
+	__m256d const swapped = _mm256_cmp_pd( absY, absX, _CMP_GT_OQ );
+	__m256d const ratio = _mm256_div_pd( _mm256_min_pd( absX, absY ), _mm256_blendv_pd( larger, one, bothZero ) );
+	__m256d const upper = _mm256_cmp_pd( ratio, _mm256_set1_pd( ATAN_SPLIT ), _CMP_GT_OQ );
+	__m256d const t = _mm256_blendv_pd( ratio, _mm256_div_pd( _mm256_sub_pd( ratio, one ), _mm256_add_pd( ratio, one ) ), upper );
+	__m256d const z = _mm256_mul_pd( t, t );
+	__m256d numerator = _mm256_add_pd( _mm256_mul_pd( _mm256_set1_pd( ATAN_P0 ), z ), _mm256_set1_pd( ATAN_P1 ) );
+	numerator = _mm256_add_pd( _mm256_mul_pd( numerator, z ), _mm256_set1_pd( ATAN_P2 ) );
+	numerator = _mm256_add_pd( _mm256_mul_pd( numerator, z ), _mm256_set1_pd( ATAN_P3 ) );
+	numerator = _mm256_mul_pd( _mm256_add_pd( _mm256_mul_pd( numerator, z ), _mm256_set1_pd( ATAN_P4 ) ), z );
+	__m256d denominator = _mm256_add_pd( z, _mm256_set1_pd( ATAN_Q0 ) );
+	denominator = _mm256_add_pd( _mm256_mul_pd( denominator, z ), _mm256_set1_pd( ATAN_Q1 ) );
+	denominator = _mm256_add_pd( _mm256_mul_pd( denominator, z ), _mm256_set1_pd( ATAN_Q2 ) );
+	denominator = _mm256_add_pd( _mm256_mul_pd( denominator, z ), _mm256_set1_pd( ATAN_Q3 ) );
+	denominator = _mm256_add_pd( _mm256_mul_pd( denominator, z ), _mm256_set1_pd( ATAN_Q4 ) );
+	__m256d arcTangent = _mm256_add_pd( _mm256_mul_pd( t, _mm256_div_pd( numerator, denominator ) ), t );
+
+	//Octant and sign of the atan, flipping the sign is exact so it's done on the sign bit
+	__m256d const two = _mm256_set1_pd( 2.0 );
+	__m256d const four = _mm256_set1_pd( 4.0 );
+	__m256d const negativeX = _mm256_cmp_pd( X, zero, _CMP_LT_OQ );
+	__m256d octants = _mm256_and_pd( upper, one );
+	octants = _mm256_blendv_pd( octants, _mm256_sub_pd( two, octants ), swapped );
+	octants = _mm256_blendv_pd( octants, _mm256_sub_pd( four, octants ), negativeX );
+	arcTangent = _mm256_xor_pd( arcTangent, _mm256_and_pd( _mm256_xor_pd( swapped, negativeX ), signBit ) );
+	__m256d angle = _mm256_add_pd( _mm256_mul_pd( octants, _mm256_set1_pd( PI_4_HI ) ),
+			_mm256_add_pd( arcTangent, _mm256_mul_pd( octants, _mm256_set1_pd( PI_4_LO ) ) ) );
+
+	angle = _mm256_or_pd( angle, _mm256_and_pd( Y, signBit ) );
+	return _mm256_andnot_pd( bothZero, angle );
+}
+
+__attribute__(( target( "avx2" ) ))
+inline void KinematicsAVX2( double const * Pxs, double const * Pys, double const * Pzs, double const * Energies,
+		unsigned int Begin, unsigned int End,
+		double * Perp2s, double * Rapidities, double * Phis )
+{
+	__m256d const smallest = _mm256_set1_pd( DBL_MIN );
+	__m256d const largest = _mm256_set1_pd( DBL_MAX );
+	__m256d const half = _mm256_set1_pd( 0.5 );
+
+	unsigned int i = Begin;
+	for ( ; i + 4 <= End; i += 4 )
+	{
+		__m256d const px = _mm256_loadu_pd( Pxs + i );
+		__m256d const py = _mm256_loadu_pd( Pys + i );
+		__m256d const pz = _mm256_loadu_pd( Pzs + i );
+		__m256d const energy = _mm256_loadu_pd( Energies + i );
+		_mm256_storeu_pd( Perp2s + i, _mm256_add_pd( _mm256_mul_pd( px, px ), _mm256_mul_pd( py, py ) ) );
+		_mm256_storeu_pd( Phis + i, ApproximateAtan2AVX2( py, px ) );
+
+		//Anything log can't take, including E = |pz|, is re-done with libm
+		__m256d const ratio = _mm256_div_pd( _mm256_add_pd( energy, pz ), _mm256_sub_pd( energy, pz ) );
+		_mm256_storeu_pd( Rapidities + i, _mm256_mul_pd( half, ApproximateLogAVX2( ratio ) ) );
+		__m256d const isNormal = _mm256_and_pd( _mm256_cmp_pd( ratio, smallest, _CMP_GE_OQ ), _mm256_cmp_pd( ratio, largest, _CMP_LE_OQ ) );
+		if ( _mm256_movemask_pd( isNormal ) != 0xF ) KinematicsScalar( Pxs, Pys, Pzs, Energies, i, i + 4, Perp2s, Rapidities, Phis );
+	}
+	KinematicsScalar( Pxs, Pys, Pzs, Energies, i, End, Perp2s, Rapidities, Phis );
+}
+
+__attribute__(( target( "avx512f" ) ))
+inline __m512d ApproximateLogAVX512( __m512d X )
+{
+	using namespace KinematicsConstants;
+	__m512i const bits = _mm512_add_epi64( _mm512_castpd_si512( X ), _mm512_set1_epi64( SQRT_HALF_OFFSET ) );
+	__m512d const k = _mm512_sub_pd( _mm512_castsi512_pd( _mm512_maskz_or_epi64( 0xFF, _mm512_maskz_srli_epi64( 0xFF, bits, 52 ), _mm512_set1_epi64( TWO_52_BITS ) ) ),
+			_mm512_set1_pd( TWO_52_PLUS_BIAS ) );
+	__m512d const f = _mm512_sub_pd( _mm512_castsi512_pd( _mm512_add_epi64( _mm512_maskz_and_epi64( 0xFF, bits, _mm512_set1_epi64( MANTISSA_MASK ) ),
+			_mm512_set1_epi64( SQRT_HALF_BITS ) ) ), _mm512_set1_pd( 1.0 ) );
+
+	__m512d const halfF2 = _mm512_mul_pd( _mm512_mul_pd( _mm512_set1_pd( 0.5 ), f ), f );
+	__m512d const s = _mm512_div_pd( f, _mm512_add_pd( _mm512_set1_pd( 2.0 ), f ) );
+	__m512d const z = _mm512_mul_pd( s, s );
+	__m512d const w = _mm512_mul_pd( z, z );
+	__m512d evens = _mm512_add_pd( _mm512_set1_pd( LG4 ), _mm512_mul_pd( w, _mm512_set1_pd( LG6 ) ) );
+	evens = _mm512_mul_pd( w, _mm512_add_pd( _mm512_set1_pd( LG2 ), _mm512_mul_pd( w, evens ) ) );
+	__m512d odds = _mm512_add_pd( _mm512_set1_pd( LG5 ), _mm512_mul_pd( w, _mm512_set1_pd( LG7 ) ) );
+	odds = _mm512_add_pd( _mm512_set1_pd( LG3 ), _mm512_mul_pd( w, odds ) );
+	odds = _mm512_mul_pd( z, _mm512_add_pd( _mm512_set1_pd( LG1 ), _mm512_mul_pd( w, odds ) ) );
+
+	__m512d result = _mm512_mul_pd( s, _mm512_add_pd( halfF2, _mm512_add_pd( odds, evens ) ) );
+	result = _mm512_add_pd( result, _mm512_mul_pd( k, _mm512_set1_pd( LN2_LO ) ) );
+	result = _mm512_sub_pd( result, halfF2 );
+	result = _mm512_add_pd( result, f );
+	return _mm512_add_pd( result, _mm512_mul_pd( k, _mm512_set1_pd( LN2_HI ) ) );
+}
+
+__attribute__(( target( "avx512f" ) ))
+inline __m512d ApproximateAtan2AVX512( __m512d Y, __m512d X )
+{
+	using namespace KinematicsConstants;
+	__m512i const signBit = _mm512_set1_epi64( 0x8000000000000000ULL );
+	__m512d const zero = _mm512_setzero_pd();
+	__m512d const one = _mm512_set1_pd( 1.0 );
+	__m512d const absX = _mm512_castsi512_pd( _mm512_maskz_andnot_epi64( 0xFF, signBit, _mm512_castpd_si512( X ) ) );
+	__m512d const absY = _mm512_castsi512_pd( _mm512_maskz_andnot_epi64( 0xFF, signBit, _mm512_castpd_si512( Y ) ) );
+	__m512d const larger = _mm512_maskz_max_pd( 0xFF, absX, absY );
+	__mmask8 const bothZero = _mm512_cmp_pd_mask( larger, zero, _CMP_EQ_OQ );
+
+	__mmask8 const swapped = _mm512_cmp_pd_mask( absY, absX, _CMP_GT_OQ );
+	__m512d const ratio = _mm512_div_pd( _mm512_maskz_min_pd( 0xFF, absX, absY ), _mm512_mask_blend_pd( bothZero, larger, one ) );
+	__mmask8 const upper = _mm512_cmp_pd_mask( ratio, _mm512_set1_pd( ATAN_SPLIT ), _CMP_GT_OQ );
+	__m512d const t = _mm512_mask_blend_pd( upper, ratio, _mm512_div_pd( _mm512_sub_pd( ratio, one ), _mm512_add_pd( ratio, one ) ) );
+	__m512d const z = _mm512_mul_pd( t, t );
+	__m512d numerator = _mm512_add_pd( _mm512_mul_pd( _mm512_set1_pd( ATAN_P0 ), z ), _mm512_set1_pd( ATAN_P1 ) );
+	numerator = _mm512_add_pd( _mm512_mul_pd( numerator, z ), _mm512_set1_pd( ATAN_P2 ) );
+	numerator = _mm512_add_pd( _mm512_mul_pd( numerator, z ), _mm512_set1_pd( ATAN_P3 ) );
+	numerator = _mm512_mul_pd( _mm512_add_pd( _mm512_mul_pd( numerator, z ), _mm512_set1_pd( ATAN_P4 ) ), z );
+	__m512d denominator = _mm512_add_pd( z, _mm512_set1_pd( ATAN_Q0 ) );
+	denominator = _mm512_add_pd( _mm512_mul_pd( denominator, z ), _mm512_set1_pd( ATAN_Q1 ) );
+	denominator = _mm512_add_pd( _mm512_mul_pd( denominator, z ), _mm512_set1_pd( ATAN_Q2 ) );
+	denominator = _mm512_add_pd( _mm512_mul_pd( denominator, z ), _mm512_set1_pd( ATAN_Q3 ) );
+	denominator = _mm512_add_pd( _mm512_mul_pd( denominator, z ), _mm512_set1_pd( ATAN_Q4 ) );
+	__m512d arcTangent = _mm512_add_pd( _mm512_mul_pd( t, _mm512_div_pd( numerator, denominator ) ), t );
+
+	__mmask8 const negativeX = _mm512_cmp_pd_mask( X, zero, _CMP_LT_OQ );
+	__m512d octants = _mm512_maskz_mov_pd( upper, one );
+	octants = _mm512_mask_sub_pd( octants, swapped, _mm512_set1_pd( 2.0 ), octants );
+	octants = _mm512_mask_sub_pd( octants, negativeX, _mm512_set1_pd( 4.0 ), octants );
+	__m512i const flip = _mm512_maskz_mov_epi64( swapped ^ negativeX, signBit );
+	arcTangent = _mm512_castsi512_pd( _mm512_maskz_xor_epi64( 0xFF, _mm512_castpd_si512( arcTangent ), flip ) );
+	__m512d angle = _mm512_add_pd( _mm512_mul_pd( octants, _mm512_set1_pd( PI_4_HI ) ),
+			_mm512_add_pd( arcTangent, _mm512_mul_pd( octants, _mm512_set1_pd( PI_4_LO ) ) ) );
+
+	angle = _mm512_castsi512_pd( _mm512_maskz_or_epi64( 0xFF, _mm512_castpd_si512( angle ), _mm512_maskz_and_epi64( 0xFF, _mm512_castpd_si512( Y ), signBit ) ) );
+	return _mm512_maskz_mov_pd( ( __mmask8 )~bothZero, angle );
+}
+
+__attribute__(( target( "avx512f" ) ))
+inline void KinematicsAVX512( double const * Pxs, double const * Pys, double const * Pzs, double const * Energies,
+		unsigned int Begin, unsigned int End,
+		double * Perp2s, double * Rapidities, double * Phis )
+{
+	__m512d const smallest = _mm512_set1_pd( DBL_MIN );
+	__m512d const largest = _mm512_set1_pd( DBL_MAX );
+	__m512d const half = _mm512_set1_pd( 0.5 );
+
+	unsigned int i = Begin;
+	for ( ; i + 8 <= End; i += 8 )
+	{
+		__m512d const px = _mm512_loadu_pd( Pxs + i );
+		__m512d const py = _mm512_loadu_pd( Pys + i );
+		__m512d const pz = _mm512_loadu_pd( Pzs + i );
+		__m512d const energy = _mm512_loadu_pd( Energies + i );
+		_mm512_storeu_pd( Perp2s + i, _mm512_add_pd( _mm512_mul_pd( px, px ), _mm512_mul_pd( py, py ) ) );
+		_mm512_storeu_pd( Phis + i, ApproximateAtan2AVX512( py, px ) );
+
+		__m512d const ratio = _mm512_div_pd( _mm512_add_pd( energy, pz ), _mm512_sub_pd( energy, pz ) );
+		_mm512_storeu_pd( Rapidities + i, _mm512_mul_pd( half, ApproximateLogAVX512( ratio ) ) );
+		__mmask8 const isNormal = _mm512_cmp_pd_mask( ratio, smallest, _CMP_GE_OQ ) & _mm512_cmp_pd_mask( ratio, largest, _CMP_LE_OQ );
+		if ( isNormal != 0xFF ) KinematicsScalar( Pxs, Pys, Pzs, Energies, i, i + 8, Perp2s, Rapidities, Phis );
+	}
+	KinematicsScalar( Pxs, Pys, Pzs, Energies, i, End, Perp2s, Rapidities, Phis );
+}
+
+//Choose a kinematics kernel by name: "exact", or "auto" for the widest approximation this CPU supports
+//Returns null for an unknown or unsupported name
+inline KinematicsKernel SelectKinematicsKernel( std::string const& Name, std::string * ChosenName = 0 )
+{
+	__builtin_cpu_init();
+	std::string chosen = Name;
+	if ( Name == "auto" )
+	{
+		if ( __builtin_cpu_supports( "avx512f" ) ) chosen = "avx512";
+		else if ( __builtin_cpu_supports( "avx2" ) ) chosen = "avx2";
+		else chosen = "scalar";
+	}
+	if ( ChosenName ) *ChosenName = chosen;
+
+	if ( chosen == "exact" ) return KinematicsExact;
+	if ( chosen == "scalar" ) return KinematicsScalar;
+	if ( chosen == "avx2" && __builtin_cpu_supports( "avx2" ) ) return KinematicsAVX2;
+	if ( chosen == "avx512" && __builtin_cpu_supports( "avx512f" ) ) return KinematicsAVX512;
+	return 0;
+}
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef KT_ALGORITHMS_H
+#define KT_ALGORITHMS_H
+
+#include <cmath>
+#include <algorithm>
+
+//Generalised kt: d_iB = pt_i^2p, d_ij = min( pt_i^2p, pt_j^2p ) x delta_R^2 / R^2
+//Each algorithm turns pt^2 into the per-object weight once, so the pair loop never calls pow
+//and the weight combination is chosen at compile time
+
+//p = -1
+struct AntiKt
+{
+	static char const * Name()
+	{
+		return "anti-kt";
+	}
+	double Weight( double Pt2 ) const
+	{
+		return 1.0 / Pt2;
+	}
+	static double PairWeight( double ThisWeight, double PairWeight )
+	{
+		return std::min( ThisWeight, PairWeight );
+	}
+};
+
+//p = 1
+struct Kt
+{
+	static char const * Name()
+	{
+		return "kt";
+	}
+	double Weight( double Pt2 ) const
+	{
+		return Pt2;
+	}
+	static double PairWeight( double ThisWeight, double PairWeight )
+	{
+		return std::min( ThisWeight, PairWeight );
+	}
+};
+
+//p = 0, the weights are all one so pairs are purely geometric
+struct CambridgeAachen
+{
+	static char const * Name()
+	{
+		return "Cambridge/Aachen";
+	}
+	double Weight( double ) const
+	{
+		return 1.0;
+	}
+	static double PairWeight( double, double )
+	{
+		return 1.0;
+	}
+};
+
+//Any other p, at the cost of one pow per object and per merge
+struct GeneralisedKt
+{
+	double p;
+
+	GeneralisedKt( double P = 0.5 ) : p( P )
+	{
+	}
+	static char const * Name()
+	{
+		return "generalised kt";
+	}
+	double Weight( double Pt2 ) const
+	{
+		return pow( Pt2, p );
+	}
+	static double PairWeight( double ThisWeight, double PairWeight )
+	{
+		return std::min( ThisWeight, PairWeight );
+	}
+};
+
+//Radius known when compiling, as a ratio so it can be a template argument
+template< int NUMERATOR, int DENOMINATOR >
+struct FixedRadius
+{
+	static constexpr double R = double( NUMERATOR ) / double( DENOMINATOR );
+	static constexpr double INVERSE_R2 = double( DENOMINATOR * DENOMINATOR ) / double( NUMERATOR * NUMERATOR );
+
+	double Value() const
+	{
+		return R;
+	}
+	double InverseR2() const
+	{
+		return INVERSE_R2;
+	}
+};
+
+//Radius chosen at run time
+struct RuntimeRadius
+{
+	double r;
+	double inverseR2;
+
+	RuntimeRadius( double R = 0.6 ) : r( R ), inverseR2( 1.0 / ( R * R ) )
+	{
+	}
+	double Value() const
+	{
+		return r;
+	}
+	double InverseR2() const
+	{
+		return inverseR2;
+	}
+};
+
+#endif
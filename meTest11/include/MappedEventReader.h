@@ -0,0 +1,192 @@
+#ifndef MAPPED_EVENT_READER_H
+#define MAPPED_EVENT_READER_H
+
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ParticleArrays.h"
+
+//Parse a decimal number, moving Cursor past it. Numbers with at most 19 significant digits and a
+//power of ten no bigger than 22 are exactly representable as m x 10^e with both parts exact doubles,
+//so one multiply or divide gives the correctly rounded result, the same as strtod. Anything else
+//(long mantissas, big exponents, inf, nan) is handed to strtod.
+//Returns false if there is no number before the end of the line.
+inline bool ParseDouble( char const *& Cursor, char const * End, double & Value )
+{
+	static double const POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	char const * cursor = Cursor;
+	while ( cursor < End && ( *cursor == ' ' || *cursor == '\t' || *cursor == '\r' ) ) cursor++;
+	char const * const start = cursor;
+
+	bool const negative = ( cursor < End && *cursor == '-' );
+	if ( cursor < End && ( *cursor == '-' || *cursor == '+' ) ) cursor++;
+
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+	for ( ; cursor < End && *cursor >= '0' && *cursor <= '9'; cursor++ )
+	{
+		anyDigits = true;
+		if ( mantissa == 0 && *cursor == '0' ) continue;
+		if ( digits < 19 ) mantissa = ( mantissa * 10 ) + ( *cursor - '0' );
+		else exponent++;
+		digits++;
+	}
+	if ( cursor < End && *cursor == '.' )
+	{
+		for ( cursor++; cursor < End && *cursor >= '0' && *cursor <= '9'; cursor++ )
+		{
+			anyDigits = true;
+			if ( mantissa == 0 && *cursor == '0' )
+			{
+				exponent--;
+				continue;
+			}
+			if ( digits < 19 )
+			{
+				mantissa = ( mantissa * 10 ) + ( *cursor - '0' );
+				exponent--;
+			}
+			digits++;
+		}
+	}
+	if ( anyDigits && cursor < End && ( *cursor == 'e' || *cursor == 'E' ) )
+	{
+		char const * exponentCursor = cursor + 1;
+		bool const negativeExponent = ( exponentCursor < End && *exponentCursor == '-' );
+		if ( exponentCursor < End && ( *exponentCursor == '-' || *exponentCursor == '+' ) ) exponentCursor++;
+		if ( exponentCursor < End && *exponentCursor >= '0' && *exponentCursor <= '9' )
+		{
+			int explicitExponent = 0;
+			for ( ; exponentCursor < End && *exponentCursor >= '0' && *exponentCursor <= '9'; exponentCursor++ )
+			{
+				if ( explicitExponent < 100000 ) explicitExponent = ( explicitExponent * 10 ) + ( *exponentCursor - '0' );
+			}
+			exponent += negativeExponent ? -explicitExponent : explicitExponent;
+			cursor = exponentCursor;
+		}
+	}
+
+	//Fast path
+	if ( anyDigits && digits <= 19 && mantissa <= ( uint64_t( 1 ) << 53 ) && exponent >= -22 && exponent <= 22 )
+	{
+		double const value = double( mantissa );
+		Value = ( exponent < 0 ) ? value / POWERS_OF_TEN[ -exponent ] : value * POWERS_OF_TEN[ exponent ];
+		if ( negative ) Value = -Value;
+		Cursor = cursor;
+		return true;
+	}
+
+	//Slow path, strtod needs the token null terminated
+	char token[ 128 ];
+	size_t length = 0;
+	for ( char const * tokenEnd = start; tokenEnd < End && length < sizeof( token ) - 1
+			&& *tokenEnd != ' ' && *tokenEnd != '\t' && *tokenEnd != '\r' && *tokenEnd != '\n'; tokenEnd++ )
+	{
+		token[ length++ ] = *tokenEnd;
+	}
+	token[ length ] = 0;
+	char * tokenEnd;
+	Value = strtod( token, &tokenEnd );
+	if ( tokenEnd == token ) return false;
+	Cursor = start + ( tokenEnd - token );
+	return true;
+}
+
+//Reads the same multi-event text format as ReadEvent, but from a memory mapped file and without
+//iostreams, parsing one event at a time straight into the particle arrays
+class MappedEventReader
+{
+	public:
+		MappedEventReader( std::string const& FileName ) : m_data( 0 ), m_size( 0 ), m_cursor( 0 )
+		{
+			int const file = open( FileName.c_str(), O_RDONLY );
+			if ( file < 0 ) return;
+
+			struct stat status;
+			if ( fstat( file, &status ) == 0 )
+			{
+				if ( status.st_size == 0 )
+				{
+					//Nothing to map
+					m_cursor = m_data = "";
+				}
+				else
+				{
+					void * const data = mmap( 0, status.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+					if ( data != MAP_FAILED )
+					{
+						madvise( data, status.st_size, MADV_SEQUENTIAL );
+						m_data = ( char const * )data;
+						m_size = status.st_size;
+						m_cursor = m_data;
+					}
+				}
+			}
+			close( file );
+		}
+		~MappedEventReader()
+		{
+			if ( m_size ) munmap( ( void * )m_data, m_size );
+		}
+
+		bool IsOpen() const
+		{
+			return m_cursor != 0;
+		}
+
+		//Returns false once there are no more events
+		bool ReadEvent( ParticleArrays & Particles )
+		{
+			Particles.clear();
+			if ( !m_cursor ) return false;
+
+			char const * const end = m_data + m_size;
+			bool sawAnything = false;
+			while ( m_cursor < end )
+			{
+				char const * lineEnd = ( char const * )memchr( m_cursor, '\n', end - m_cursor );
+				if ( !lineEnd ) lineEnd = end;
+				char const * line = m_cursor;
+				m_cursor = ( lineEnd < end ) ? lineEnd + 1 : end;
+
+				if ( line < lineEnd && *line == '#' )
+				{
+					if ( lineEnd - line >= 4 && strncmp( line, "#END", 4 ) == 0 ) return true;
+					continue;
+				}
+
+				double momentum[ 4 ];
+				unsigned int values = 0;
+				for ( ; values < 4; values++ )
+				{
+					if ( !ParseDouble( line, lineEnd, momentum[ values ] ) ) break;
+				}
+				if ( values < 4 ) continue;
+
+				Particles.push_back( momentum[ 0 ], momentum[ 1 ], momentum[ 2 ], momentum[ 3 ] );
+				sawAnything = true;
+			}
+			return sawAnything;
+		}
+
+	private:
+		char const * m_data;
+		size_t m_size;
+		char const * m_cursor;
+
+		MappedEventReader( MappedEventReader const& );
+		MappedEventReader & operator=( MappedEventReader const& );
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef MULTI_RADIUS_H
+#define MULTI_RADIUS_H
+
+#include <vector>
+#include <cfloat>
+#include <memory>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+
+#include "FourMomentum.h"
+#include "ParticleArrays.h"
+#include "ClusterDispatch.h"
+
+//One event with everything that doesn't depend on R worked out once: the four-momenta, pT^2,
+//rapidity and phi from the same kernel the clusterer uses, and each particle's nearest neighbour
+//from the same search, so clustering the view gives exactly the jets clustering the inputs would.
+//Inputs should already be sorted pT high to low. The memory is kept for the next event.
+class PreparedEvent
+{
+	public:
+		PreparedEvent() : m_capacity( 0 )
+		{
+		}
+
+		template< class Particles >
+		void Prepare( Particles const& Inputs, ClusterOptions const& Options )
+		{
+			unsigned int const total = Inputs.size();
+			m_px.resize( total );
+			m_py.resize( total );
+			m_pz.resize( total );
+			m_E.resize( total );
+			m_perp2.resize( total );
+			m_rapidity.resize( total );
+			m_phi.resize( total );
+			m_nearestDeltaR2.resize( total );
+			m_nearestNeighbour.resize( total );
+			if ( total > m_capacity )
+			{
+				m_wasDeleted.reset( new bool[ total ]() );
+				m_capacity = total;
+			}
+
+			LoadMomenta( Inputs, m_px.data(), m_py.data(), m_pz.data(), m_E.data() );
+			if ( !LoadKinematics( Inputs, Options.kinematics, m_perp2.data(), m_rapidity.data(), m_phi.data() ) )
+			{
+				Options.kinematics( m_px.data(), m_py.data(), m_pz.data(), m_E.data(), 0, total, m_perp2.data(), m_rapidity.data(), m_phi.data() );
+			}
+
+			//Searched either side of each particle, as the clusterer's first pass does
+			tbb::parallel_for( tbb::blocked_range< unsigned int >( 0, total, 256 ), [&]( tbb::blocked_range< unsigned int > const& Range )
+			{
+				for ( unsigned int i = Range.begin(); i < Range.end(); i++ )
+				{
+					double minDeltaR2 = DBL_MAX;
+					unsigned int minDeltaR2Pair = i;
+					Options.kernel( m_phi[ i ], m_rapidity[ i ], m_phi.data(), m_rapidity.data(), m_wasDeleted.get(), 0, i, minDeltaR2, minDeltaR2Pair );
+					Options.kernel( m_phi[ i ], m_rapidity[ i ], m_phi.data(), m_rapidity.data(), m_wasDeleted.get(), i + 1, total, minDeltaR2, minDeltaR2Pair );
+					m_nearestDeltaR2[ i ] = minDeltaR2;
+					m_nearestNeighbour[ i ] = minDeltaR2Pair;
+				}
+			} );
+
+			m_view.px = m_px.data();
+			m_view.py = m_py.data();
+			m_view.pz = m_pz.data();
+			m_view.E = m_E.data();
+			m_view.perp2 = m_perp2.data();
+			m_view.rapidity = m_rapidity.data();
+			m_view.phi = m_phi.data();
+			m_view.exactKinematics = ( Options.kinematics == KinematicsExact );
+			m_view.nearestDeltaR2 = m_nearestDeltaR2.data();
+			m_view.nearestNeighbour = m_nearestNeighbour.data();
+			m_view.particles = total;
+		}
+
+		ParticleView const& View() const
+		{
+			return m_view;
+		}
+		unsigned int size() const
+		{
+			return m_view.particles;
+		}
+
+	private:
+		std::vector< double > m_px;
+		std::vector< double > m_py;
+		std::vector< double > m_pz;
+		std::vector< double > m_E;
+		std::vector< double > m_perp2;
+		std::vector< double > m_rapidity;
+		std::vector< double > m_phi;
+		std::vector< double > m_nearestDeltaR2;
+		std::vector< unsigned int > m_nearestNeighbour;
+		std::unique_ptr< bool[] > m_wasDeleted; //all false, for the kernels
+		unsigned int m_capacity;
+		ParticleView m_view;
+};
+
+//Clusters a prepared event at several radii, one TBB task per radius with a workspace per thread
+//Every radius starts from the shared neighbours, so only the merging is done again for each.
+//Cluster can be called for several events at once, as the tasks never wait while holding a workspace.
+class MultiRadiusClusterer
+{
+	public:
+		MultiRadiusClusterer( double P, std::vector< double > const& Radii, ClusterOptions const& Options = ClusterOptions() )
+			: m_p( P ), m_radii( Radii ), m_options( Options )
+		{
+			//The radii are the parallel part, so each clustering stays on its own thread
+			m_options.parallelThreshold = 0;
+		}
+
+		std::vector< double > const& Radii() const
+		{
+			return m_radii;
+		}
+
+		//Outputs[ r ] gets the jets for Radii()[ r ], and Timings the timing of each if it's given
+		void Cluster( PreparedEvent const& Event, std::vector< std::vector< FourMomentum > > & Outputs, std::vector< ClusterTiming > * Timings = 0 )
+		{
+			Outputs.resize( m_radii.size() );
+			if ( Timings ) Timings->resize( m_radii.size() );
+			tbb::parallel_for( tbb::blocked_range< unsigned int >( 0, m_radii.size(), 1 ), [&]( tbb::blocked_range< unsigned int > const& Range )
+			{
+				ClusterWorkspace & workspace = m_workspaces.local();
+				for ( unsigned int radius = Range.begin(); radius < Range.end(); radius++ )
+				{
+					ClusterTiming timing;
+					Outputs[ radius ].clear();
+					ClusterJets( JetDefinition( m_p, m_radii[ radius ] ), m_options, workspace, Event.View(), Outputs[ radius ], timing );
+					if ( Timings ) ( *Timings )[ radius ] = timing;
+				}
+			} );
+		}
+
+	private:
+		double m_p;
+		std::vector< double > m_radii;
+		ClusterOptions m_options;
+		tbb::enumerable_thread_specific< ClusterWorkspace > m_workspaces;
+};
+
+#endif
@@ -0,0 +1,418 @@
+#ifndef NEIGHBOUR_KERNELS_H
+#define NEIGHBOUR_KERNELS_H
+
+#include <string>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include <immintrin.h>
+
+//Nearest neighbour search of one object over a range of others: delta_R^2 with phi wrap-around,
+//deleted objects skipped, running min and argmin. The SIMD versions evaluate 2, 4 or 8 pairs at once,
+//mask deleted lanes instead of branching, and break ties on the lowest index so every version gives
+//exactly the same answer as the scalar loop. Build with -ffp-contract=off so the compiler doesn't
+//fuse the multiply-adds differently in each version.
+//Results are only written if something closer than MinDeltaR2 is found.
+typedef void ( *NearestNeighbourKernel )( double ThisPhi, double ThisRapidity,
+		double const * Phis, double const * Rapidities, bool const * WasDeleted,
+		unsigned int Begin, unsigned int End,
+		double & MinDeltaR2, unsigned int & MinIndex );
+
+//Reference version, also does the leftovers for the SIMD versions
+inline void NearestNeighbourScalar( double ThisPhi, double ThisRapidity,
+		double const * Phis, double const * Rapidities, bool const * WasDeleted,
+		unsigned int Begin, unsigned int End,
+		double & MinDeltaR2, unsigned int & MinIndex )
+{
+	double const TWO_PI = 2.0 * M_PI;
+	for ( unsigned int pairObjectIndex = Begin; pairObjectIndex < End; pairObjectIndex++ )
+	{
+		if ( WasDeleted[ pairObjectIndex ] ) continue;
+
+		double deltaPhi = fabs( ThisPhi - Phis[ pairObjectIndex ] );
+		deltaPhi = std::min( deltaPhi, TWO_PI - deltaPhi );
+		double const deltaRapidity = ThisRapidity - Rapidities[ pairObjectIndex ];
+		double const deltaR2 = ( deltaPhi * deltaPhi ) + ( deltaRapidity * deltaRapidity );
+		if ( deltaR2 < MinDeltaR2 )
+		{
+			MinDeltaR2 = deltaR2;
+			MinIndex = pairObjectIndex;
+		}
+	}
+}
+
+//Pick the best lane, lowest index on a tie
+inline void ReduceLanes( double const * LaneMins, double const * LaneIndices, unsigned int Lanes, double & MinDeltaR2, unsigned int & MinIndex )
+{
+	for ( unsigned int lane = 0; lane < Lanes; lane++ )
+	{
+		unsigned int const index = ( unsigned int )LaneIndices[ lane ];
+		if ( LaneMins[ lane ] < MinDeltaR2 || ( LaneMins[ lane ] == MinDeltaR2 && LaneMins[ lane ] != DBL_MAX && index < MinIndex ) )
+		{
+			MinDeltaR2 = LaneMins[ lane ];
+			MinIndex = index;
+		}
+	}
+}
+
+__attribute__(( target( "sse4.2" ) ))
+inline void NearestNeighbourSSE( double ThisPhi, double ThisRapidity,
+		double const * Phis, double const * Rapidities, bool const * WasDeleted,
+		unsigned int Begin, unsigned int End,
+		double & MinDeltaR2, unsigned int & MinIndex )
+{
+	__m128d const thisPhi = _mm_set1_pd( ThisPhi );
+	__m128d const thisRapidity = _mm_set1_pd( ThisRapidity );
+	__m128d const twoPi = _mm_set1_pd( 2.0 * M_PI );
+	__m128d const signBit = _mm_set1_pd( -0.0 );
+	__m128d const infinity = _mm_set1_pd( DBL_MAX );
+	__m128d const step = _mm_set1_pd( 2.0 );
+	__m128d minDeltaR2 = infinity;
+	__m128d minIndex = _mm_setzero_pd();
+	__m128d index = _mm_set_pd( Begin + 1, Begin );
+
+	unsigned int pairObjectIndex = Begin;
+	for ( ; pairObjectIndex + 2 <= End; pairObjectIndex += 2 )
+	{
+		uint16_t deletedBytes;
+		memcpy( &deletedBytes, WasDeleted + pairObjectIndex, sizeof( deletedBytes ) );
+		__m128i const deleted = _mm_cvtepu8_epi64( _mm_cvtsi32_si128( deletedBytes ) );
+		__m128d const isLive = _mm_castsi128_pd( _mm_cmpeq_epi64( deleted, _mm_setzero_si128() ) );
+
+		__m128d deltaPhi = _mm_andnot_pd( signBit, _mm_sub_pd( thisPhi, _mm_loadu_pd( Phis + pairObjectIndex ) ) );
+		deltaPhi = _mm_min_pd( deltaPhi, _mm_sub_pd( twoPi, deltaPhi ) );
+		__m128d const deltaRapidity = _mm_sub_pd( thisRapidity, _mm_loadu_pd( Rapidities + pairObjectIndex ) );
+		__m128d deltaR2 = _mm_add_pd( _mm_mul_pd( deltaPhi, deltaPhi ), _mm_mul_pd( deltaRapidity, deltaRapidity ) );
+		deltaR2 = _mm_blendv_pd( infinity, deltaR2, isLive );
+
+		__m128d const isCloser = _mm_cmplt_pd( deltaR2, minDeltaR2 );
+		minDeltaR2 = _mm_blendv_pd( minDeltaR2, deltaR2, isCloser );
+		minIndex = _mm_blendv_pd( minIndex, index, isCloser );
+		index = _mm_add_pd( index, step );
+	}
+
+	double laneMins[ 2 ], laneIndices[ 2 ];
+	_mm_storeu_pd( laneMins, minDeltaR2 );
+	_mm_storeu_pd( laneIndices, minIndex );
+	ReduceLanes( laneMins, laneIndices, 2, MinDeltaR2, MinIndex );
+	NearestNeighbourScalar( ThisPhi, ThisRapidity, Phis, Rapidities, WasDeleted, pairObjectIndex, End, MinDeltaR2, MinIndex );
+}
+
+__attribute__(( target( "avx2" ) ))
+inline void NearestNeighbourAVX2( double ThisPhi, double ThisRapidity,
+		double const * Phis, double const * Rapidities, bool const * WasDeleted,
+		unsigned int Begin, unsigned int End,
+		double & MinDeltaR2, unsigned int & MinIndex )
+{
+	__m256d const thisPhi = _mm256_set1_pd( ThisPhi );
+	__m256d const thisRapidity = _mm256_set1_pd( ThisRapidity );
+	__m256d const twoPi = _mm256_set1_pd( 2.0 * M_PI );
+	__m256d const signBit = _mm256_set1_pd( -0.0 );
+	__m256d const infinity = _mm256_set1_pd( DBL_MAX );
+	__m256d const step = _mm256_set1_pd( 4.0 );
+	__m256d minDeltaR2 = infinity;
+	__m256d minIndex = _mm256_setzero_pd();
+	__m256d index = _mm256_set_pd( Begin + 3, Begin + 2, Begin + 1, Begin );
+
+	unsigned int pairObjectIndex = Begin;
+	for ( ; pairObjectIndex + 4 <= End; pairObjectIndex += 4 )
+	{
+		uint32_t deletedBytes;
+		memcpy( &deletedBytes, WasDeleted + pairObjectIndex, sizeof( deletedBytes ) );
+		__m256i const deleted = _mm256_cvtepu8_epi64( _mm_cvtsi32_si128( deletedBytes ) );
+		__m256d const isLive = _mm256_castsi256_pd( _mm256_cmpeq_epi64( deleted, _mm256_setzero_si256() ) );
+
+		__m256d deltaPhi = _mm256_andnot_pd( signBit, _mm256_sub_pd( thisPhi, _mm256_loadu_pd( Phis + pairObjectIndex ) ) );
+		deltaPhi = _mm256_min_pd( deltaPhi, _mm256_sub_pd( twoPi, deltaPhi ) );
+		__m256d const deltaRapidity = _mm256_sub_pd( thisRapidity, _mm256_loadu_pd( Rapidities + pairObjectIndex ) );
+		__m256d deltaR2 = _mm256_add_pd( _mm256_mul_pd( deltaPhi, deltaPhi ), _mm256_mul_pd( deltaRapidity, deltaRapidity ) );
+		deltaR2 = _mm256_blendv_pd( infinity, deltaR2, isLive );
+
+		__m256d const isCloser = _mm256_cmp_pd( deltaR2, minDeltaR2, _CMP_LT_OQ );
+		minDeltaR2 = _mm256_blendv_pd( minDeltaR2, deltaR2, isCloser );
+		minIndex = _mm256_blendv_pd( minIndex, index, isCloser );
+		index = _mm256_add_pd( index, step );
+	}
+
+	double laneMins[ 4 ], laneIndices[ 4 ];
+	_mm256_storeu_pd( laneMins, minDeltaR2 );
+	_mm256_storeu_pd( laneIndices, minIndex );
+	ReduceLanes( laneMins, laneIndices, 4, MinDeltaR2, MinIndex );
+	NearestNeighbourScalar( ThisPhi, ThisRapidity, Phis, Rapidities, WasDeleted, pairObjectIndex, End, MinDeltaR2, MinIndex );
+}
+
+__attribute__(( target( "avx512f" ) ))
+inline void NearestNeighbourAVX512( double ThisPhi, double ThisRapidity,
+		double const * Phis, double const * Rapidities, bool const * WasDeleted,
+		unsigned int Begin, unsigned int End,
+		double & MinDeltaR2, unsigned int & MinIndex )
+{
+	__m512d const thisPhi = _mm512_set1_pd( ThisPhi );
+	__m512d const thisRapidity = _mm512_set1_pd( ThisRapidity );
+	__m512d const twoPi = _mm512_set1_pd( 2.0 * M_PI );
+	__m512d const step = _mm512_set1_pd( 8.0 );
+	__m512d minDeltaR2 = _mm512_set1_pd( DBL_MAX );
+	__m512d minIndex = _mm512_setzero_pd();
+	__m512d index = _mm512_set_pd( Begin + 7, Begin + 6, Begin + 5, Begin + 4, Begin + 3, Begin + 2, Begin + 1, Begin );
+
+	unsigned int pairObjectIndex = Begin;
+	for ( ; pairObjectIndex + 8 <= End; pairObjectIndex += 8 )
+	{
+		uint64_t deletedBytes;
+		memcpy( &deletedBytes, WasDeleted + pairObjectIndex, sizeof( deletedBytes ) );
+		__m512i const deleted = _mm512_maskz_cvtepu8_epi64( 0xFF, _mm_cvtsi64_si128( deletedBytes ) );
+		__mmask8 const isLive = _mm512_testn_epi64_mask( deleted, deleted );
+
+		__m512d deltaPhi = _mm512_abs_pd( _mm512_sub_pd( thisPhi, _mm512_loadu_pd( Phis + pairObjectIndex ) ) );
+		deltaPhi = _mm512_maskz_min_pd( 0xFF, deltaPhi, _mm512_sub_pd( twoPi, deltaPhi ) );
+		__m512d const deltaRapidity = _mm512_sub_pd( thisRapidity, _mm512_loadu_pd( Rapidities + pairObjectIndex ) );
+		__m512d const deltaR2 = _mm512_add_pd( _mm512_mul_pd( deltaPhi, deltaPhi ), _mm512_mul_pd( deltaRapidity, deltaRapidity ) );
+
+		__mmask8 const isCloser = _mm512_mask_cmp_pd_mask( isLive, deltaR2, minDeltaR2, _CMP_LT_OQ );
+		minDeltaR2 = _mm512_mask_mov_pd( minDeltaR2, isCloser, deltaR2 );
+		minIndex = _mm512_mask_mov_pd( minIndex, isCloser, index );
+		index = _mm512_add_pd( index, step );
+	}
+
+	double laneMins[ 8 ], laneIndices[ 8 ];
+	_mm512_storeu_pd( laneMins, minDeltaR2 );
+	_mm512_storeu_pd( laneIndices, minIndex );
+	ReduceLanes( laneMins, laneIndices, 8, MinDeltaR2, MinIndex );
+	NearestNeighbourScalar( ThisPhi, ThisRapidity, Phis, Rapidities, WasDeleted, pairObjectIndex, End, MinDeltaR2, MinIndex );
+}
+
+//Single precision versions of the search, twice as many pairs per instruction and half the memory.
+//They also keep the second smallest delta_R^2, so the caller can tell whether the float answer is
+//clear of rounding or needs re-doing in double: ties in float always show up as Second == Min.
+typedef void ( *NearestNeighbourKernelFloat )( float ThisPhi, float ThisRapidity,
+		float const * Phis, float const * Rapidities, bool const * WasDeleted,
+		unsigned int Begin, unsigned int End,
+		float & MinDeltaR2, float & SecondDeltaR2, unsigned int & MinIndex );
+
+inline void NearestNeighbourScalarFloat( float ThisPhi, float ThisRapidity,
+		float const * Phis, float const * Rapidities, bool const * WasDeleted,
+		unsigned int Begin, unsigned int End,
+		float & MinDeltaR2, float & SecondDeltaR2, unsigned int & MinIndex )
+{
+	float const TWO_PI = 2.0f * float( M_PI );
+	for ( unsigned int pairObjectIndex = Begin; pairObjectIndex < End; pairObjectIndex++ )
+	{
+		if ( WasDeleted[ pairObjectIndex ] ) continue;
+
+		float deltaPhi = fabsf( ThisPhi - Phis[ pairObjectIndex ] );
+		deltaPhi = std::min( deltaPhi, TWO_PI - deltaPhi );
+		float const deltaRapidity = ThisRapidity - Rapidities[ pairObjectIndex ];
+		float const deltaR2 = ( deltaPhi * deltaPhi ) + ( deltaRapidity * deltaRapidity );
+		if ( deltaR2 < MinDeltaR2 )
+		{
+			SecondDeltaR2 = MinDeltaR2;
+			MinDeltaR2 = deltaR2;
+			MinIndex = pairObjectIndex;
+		}
+		else if ( deltaR2 < SecondDeltaR2 )
+		{
+			SecondDeltaR2 = deltaR2;
+		}
+	}
+}
+
+//Fold the lanes into the running min and second min
+inline void ReduceLanesFloat( float const * LaneMins, float const * LaneSeconds, unsigned int const * LaneIndices, unsigned int Lanes,
+		float & MinDeltaR2, float & SecondDeltaR2, unsigned int & MinIndex )
+{
+	for ( unsigned int lane = 0; lane < Lanes; lane++ )
+	{
+		if ( LaneMins[ lane ] < MinDeltaR2 )
+		{
+			SecondDeltaR2 = std::min( MinDeltaR2, LaneSeconds[ lane ] );
+			MinDeltaR2 = LaneMins[ lane ];
+			MinIndex = LaneIndices[ lane ];
+		}
+		else
+		{
+			SecondDeltaR2 = std::min( SecondDeltaR2, LaneMins[ lane ] );
+		}
+	}
+}
+
+__attribute__(( target( "sse4.2" ) ))
+inline void NearestNeighbourSSEFloat( float ThisPhi, float ThisRapidity,
+		float const * Phis, float const * Rapidities, bool const * WasDeleted,
+		unsigned int Begin, unsigned int End,
+		float & MinDeltaR2, float & SecondDeltaR2, unsigned int & MinIndex )
+{
+	__m128 const thisPhi = _mm_set1_ps( ThisPhi );
+	__m128 const thisRapidity = _mm_set1_ps( ThisRapidity );
+	__m128 const twoPi = _mm_set1_ps( 2.0f * float( M_PI ) );
+	__m128 const signBit = _mm_set1_ps( -0.0f );
+	__m128 const infinity = _mm_set1_ps( FLT_MAX );
+	__m128i const step = _mm_set1_epi32( 4 );
+	__m128 minDeltaR2 = infinity;
+	__m128 secondDeltaR2 = infinity;
+	__m128i minIndex = _mm_setzero_si128();
+	__m128i index = _mm_set_epi32( Begin + 3, Begin + 2, Begin + 1, Begin );
+
+	unsigned int pairObjectIndex = Begin;
+	for ( ; pairObjectIndex + 4 <= End; pairObjectIndex += 4 )
+	{
+		uint32_t deletedBytes;
+		memcpy( &deletedBytes, WasDeleted + pairObjectIndex, sizeof( deletedBytes ) );
+		__m128i const deleted = _mm_cvtepu8_epi32( _mm_cvtsi32_si128( deletedBytes ) );
+		__m128 const isLive = _mm_castsi128_ps( _mm_cmpeq_epi32( deleted, _mm_setzero_si128() ) );
+
+		__m128 deltaPhi = _mm_andnot_ps( signBit, _mm_sub_ps( thisPhi, _mm_loadu_ps( Phis + pairObjectIndex ) ) );
+		deltaPhi = _mm_min_ps( deltaPhi, _mm_sub_ps( twoPi, deltaPhi ) );
+		__m128 const deltaRapidity = _mm_sub_ps( thisRapidity, _mm_loadu_ps( Rapidities + pairObjectIndex ) );
+		__m128 deltaR2 = _mm_add_ps( _mm_mul_ps( deltaPhi, deltaPhi ), _mm_mul_ps( deltaRapidity, deltaRapidity ) );
+		deltaR2 = _mm_blendv_ps( infinity, deltaR2, isLive );
+
+		__m128 const isCloser = _mm_cmplt_ps( deltaR2, minDeltaR2 );
+		secondDeltaR2 = _mm_min_ps( secondDeltaR2, _mm_max_ps( minDeltaR2, deltaR2 ) );
+		minDeltaR2 = _mm_blendv_ps( minDeltaR2, deltaR2, isCloser );
+		minIndex = _mm_castps_si128( _mm_blendv_ps( _mm_castsi128_ps( minIndex ), _mm_castsi128_ps( index ), isCloser ) );
+		index = _mm_add_epi32( index, step );
+	}
+
+	float laneMins[ 4 ], laneSeconds[ 4 ];
+	unsigned int laneIndices[ 4 ];
+	_mm_storeu_ps( laneMins, minDeltaR2 );
+	_mm_storeu_ps( laneSeconds, secondDeltaR2 );
+	_mm_storeu_si128( ( __m128i * )laneIndices, minIndex );
+	ReduceLanesFloat( laneMins, laneSeconds, laneIndices, 4, MinDeltaR2, SecondDeltaR2, MinIndex );
+	NearestNeighbourScalarFloat( ThisPhi, ThisRapidity, Phis, Rapidities, WasDeleted, pairObjectIndex, End, MinDeltaR2, SecondDeltaR2, MinIndex );
+}
+
+__attribute__(( target( "avx2" ) ))
+inline void NearestNeighbourAVX2Float( float ThisPhi, float ThisRapidity,
+		float const * Phis, float const * Rapidities, bool const * WasDeleted,
+		unsigned int Begin, unsigned int End,
+		float & MinDeltaR2, float & SecondDeltaR2, unsigned int & MinIndex )
+{
+	__m256 const thisPhi = _mm256_set1_ps( ThisPhi );
+	__m256 const thisRapidity = _mm256_set1_ps( ThisRapidity );
+	__m256 const twoPi = _mm256_set1_ps( 2.0f * float( M_PI ) );
+	__m256 const signBit = _mm256_set1_ps( -0.0f );
+	__m256 const infinity = _mm256_set1_ps( FLT_MAX );
+	__m256i const step = _mm256_set1_epi32( 8 );
+	__m256 minDeltaR2 = infinity;
+	__m256 secondDeltaR2 = infinity;
+	__m256i minIndex = _mm256_setzero_si256();
+	__m256i index = _mm256_set_epi32( Begin + 7, Begin + 6, Begin + 5, Begin + 4, Begin + 3, Begin + 2, Begin + 1, Begin );
+
+	unsigned int pairObjectIndex = Begin;
+	for ( ; pairObjectIndex + 8 <= End; pairObjectIndex += 8 )
+	{
+		uint64_t deletedBytes;
+		memcpy( &deletedBytes, WasDeleted + pairObjectIndex, sizeof( deletedBytes ) );
+		__m256i const deleted = _mm256_cvtepu8_epi32( _mm_cvtsi64_si128( deletedBytes ) );
+		__m256 const isLive = _mm256_castsi256_ps( _mm256_cmpeq_epi32( deleted, _mm256_setzero_si256() ) );
+
+		__m256 deltaPhi = _mm256_andnot_ps( signBit, _mm256_sub_ps( thisPhi, _mm256_loadu_ps( Phis + pairObjectIndex ) ) );
+		deltaPhi = _mm256_min_ps( deltaPhi, _mm256_sub_ps( twoPi, deltaPhi ) );
+		__m256 const deltaRapidity = _mm256_sub_ps( thisRapidity, _mm256_loadu_ps( Rapidities + pairObjectIndex ) );
+		__m256 deltaR2 = _mm256_add_ps( _mm256_mul_ps( deltaPhi, deltaPhi ), _mm256_mul_ps( deltaRapidity, deltaRapidity ) );
+		deltaR2 = _mm256_blendv_ps( infinity, deltaR2, isLive );
+
+		__m256 const isCloser = _mm256_cmp_ps( deltaR2, minDeltaR2, _CMP_LT_OQ );
+		secondDeltaR2 = _mm256_min_ps( secondDeltaR2, _mm256_max_ps( minDeltaR2, deltaR2 ) );
+		minDeltaR2 = _mm256_blendv_ps( minDeltaR2, deltaR2, isCloser );
+		minIndex = _mm256_castps_si256( _mm256_blendv_ps( _mm256_castsi256_ps( minIndex ), _mm256_castsi256_ps( index ), isCloser ) );
+		index = _mm256_add_epi32( index, step );
+	}
+
+	float laneMins[ 8 ], laneSeconds[ 8 ];
+	unsigned int laneIndices[ 8 ];
+	_mm256_storeu_ps( laneMins, minDeltaR2 );
+	_mm256_storeu_ps( laneSeconds, secondDeltaR2 );
+	_mm256_storeu_si256( ( __m256i * )laneIndices, minIndex );
+	ReduceLanesFloat( laneMins, laneSeconds, laneIndices, 8, MinDeltaR2, SecondDeltaR2, MinIndex );
+	NearestNeighbourScalarFloat( ThisPhi, ThisRapidity, Phis, Rapidities, WasDeleted, pairObjectIndex, End, MinDeltaR2, SecondDeltaR2, MinIndex );
+}
+
+__attribute__(( target( "avx512f" ) ))
+inline void NearestNeighbourAVX512Float( float ThisPhi, float ThisRapidity,
+		float const * Phis, float const * Rapidities, bool const * WasDeleted,
+		unsigned int Begin, unsigned int End,
+		float & MinDeltaR2, float & SecondDeltaR2, unsigned int & MinIndex )
+{
+	__m512 const thisPhi = _mm512_set1_ps( ThisPhi );
+	__m512 const thisRapidity = _mm512_set1_ps( ThisRapidity );
+	__m512 const twoPi = _mm512_set1_ps( 2.0f * float( M_PI ) );
+	__m512 const infinity = _mm512_set1_ps( FLT_MAX );
+	__m512i const step = _mm512_set1_epi32( 16 );
+	__m512 minDeltaR2 = infinity;
+	__m512 secondDeltaR2 = infinity;
+	__m512i minIndex = _mm512_setzero_si512();
+	__m512i index = _mm512_add_epi32( _mm512_set1_epi32( Begin ), _mm512_set_epi32( 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 ) );
+
+	//The masked forms only because gcc warns about the undefined pass-through of the plain ones
+	unsigned int pairObjectIndex = Begin;
+	for ( ; pairObjectIndex + 16 <= End; pairObjectIndex += 16 )
+	{
+		__m512i const deleted = _mm512_maskz_cvtepu8_epi32( 0xFFFF, _mm_loadu_si128( ( __m128i const * )( WasDeleted + pairObjectIndex ) ) );
+		__mmask16 const isLive = _mm512_testn_epi32_mask( deleted, deleted );
+
+		__m512 deltaPhi = _mm512_abs_ps( _mm512_sub_ps( thisPhi, _mm512_loadu_ps( Phis + pairObjectIndex ) ) );
+		deltaPhi = _mm512_maskz_min_ps( 0xFFFF, deltaPhi, _mm512_sub_ps( twoPi, deltaPhi ) );
+		__m512 const deltaRapidity = _mm512_sub_ps( thisRapidity, _mm512_loadu_ps( Rapidities + pairObjectIndex ) );
+		__m512 deltaR2 = _mm512_add_ps( _mm512_mul_ps( deltaPhi, deltaPhi ), _mm512_mul_ps( deltaRapidity, deltaRapidity ) );
+		deltaR2 = _mm512_mask_mov_ps( infinity, isLive, deltaR2 );
+
+		__mmask16 const isCloser = _mm512_cmp_ps_mask( deltaR2, minDeltaR2, _CMP_LT_OQ );
+		secondDeltaR2 = _mm512_maskz_min_ps( 0xFFFF, secondDeltaR2, _mm512_maskz_max_ps( 0xFFFF, minDeltaR2, deltaR2 ) );
+		minDeltaR2 = _mm512_mask_mov_ps( minDeltaR2, isCloser, deltaR2 );
+		minIndex = _mm512_mask_mov_epi32( minIndex, isCloser, index );
+		index = _mm512_add_epi32( index, step );
+	}
+
+	float laneMins[ 16 ], laneSeconds[ 16 ];
+	unsigned int laneIndices[ 16 ];
+	_mm512_storeu_ps( laneMins, minDeltaR2 );
+	_mm512_storeu_ps( laneSeconds, secondDeltaR2 );
+	_mm512_storeu_si512( laneIndices, minIndex );
+	ReduceLanesFloat( laneMins, laneSeconds, laneIndices, 16, MinDeltaR2, SecondDeltaR2, MinIndex );
+	NearestNeighbourScalarFloat( ThisPhi, ThisRapidity, Phis, Rapidities, WasDeleted, pairObjectIndex, End, MinDeltaR2, SecondDeltaR2, MinIndex );
+}
+
+//Turn "auto" into the widest kernel this CPU supports, other names are left alone
+inline std::string ResolveKernelName( std::string const& Name )
+{
+	__builtin_cpu_init();
+	if ( Name != "auto" ) return Name;
+	if ( __builtin_cpu_supports( "avx512f" ) ) return "avx512";
+	if ( __builtin_cpu_supports( "avx2" ) ) return "avx2";
+	if ( __builtin_cpu_supports( "sse4.2" ) ) return "sse4.2";
+	return "scalar";
+}
+
+//Choose a kernel by name, "auto" takes the widest one this CPU supports
+//Returns null for an unknown or unsupported name
+inline NearestNeighbourKernel SelectNearestNeighbourKernel( std::string const& Name, std::string * ChosenName = 0 )
+{
+	std::string const chosen = ResolveKernelName( Name );
+	if ( ChosenName ) *ChosenName = chosen;
+
+	if ( chosen == "scalar" ) return NearestNeighbourScalar;
+	if ( chosen == "sse4.2" && __builtin_cpu_supports( "sse4.2" ) ) return NearestNeighbourSSE;
+	if ( chosen == "avx2" && __builtin_cpu_supports( "avx2" ) ) return NearestNeighbourAVX2;
+	if ( chosen == "avx512" && __builtin_cpu_supports( "avx512f" ) ) return NearestNeighbourAVX512;
+	return 0;
+}
+
+//The same for the single precision kernels
+inline NearestNeighbourKernelFloat SelectNearestNeighbourKernelFloat( std::string const& Name, std::string * ChosenName = 0 )
+{
+	std::string const chosen = ResolveKernelName( Name );
+	if ( ChosenName ) *ChosenName = chosen;
+
+	if ( chosen == "scalar" ) return NearestNeighbourScalarFloat;
+	if ( chosen == "sse4.2" && __builtin_cpu_supports( "sse4.2" ) ) return NearestNeighbourSSEFloat;
+	if ( chosen == "avx2" && __builtin_cpu_supports( "avx2" ) ) return NearestNeighbourAVX2Float;
+	if ( chosen == "avx512" && __builtin_cpu_supports( "avx512f" ) ) return NearestNeighbourAVX512Float;
+	return 0;
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef PARTICLE_ARRAYS_H
+#define PARTICLE_ARRAYS_H
+
+#include <vector>
+#include <algorithm>
+
+//Four-momenta of one event as separate arrays, filled straight from the input with no
+//four-vector objects in between. Clearing keeps the capacity, so the same object can be reused for
+//every event.
+struct ParticleArrays
+{
+	std::vector< double > px;
+	std::vector< double > py;
+	std::vector< double > pz;
+	std::vector< double > E;
+
+	unsigned int size() const
+	{
+		return px.size();
+	}
+
+	void clear()
+	{
+		px.clear();
+		py.clear();
+		pz.clear();
+		E.clear();
+	}
+
+	void push_back( double Px, double Py, double Pz, double TheE )
+	{
+		px.push_back( Px );
+		py.push_back( Py );
+		pz.push_back( Pz );
+		E.push_back( TheE );
+	}
+
+	//Order pT high to low, like sorting TLVs before clustering
+	//Order, if given, gets where each particle was before, so positions in the sorted event can be
+	//turned back into positions as read
+	void SortByPt( std::vector< unsigned int > * Order = 0 )
+	{
+		unsigned int const total = this->size();
+		m_order.resize( total );
+		m_pt2s.resize( total );
+		for ( unsigned int i = 0; i < total; i++ )
+		{
+			m_order[ i ] = i;
+			m_pt2s[ i ] = ( px[ i ] * px[ i ] ) + ( py[ i ] * py[ i ] );
+		}
+		std::vector< double > const& pt2s = m_pt2s;
+		std::sort( m_order.begin(), m_order.end(), [&pt2s]( unsigned int i, unsigned int j ){ return pt2s[ i ] > pt2s[ j ]; } );
+
+		Reorder( px );
+		Reorder( py );
+		Reorder( pz );
+		Reorder( E );
+		if ( Order ) Order->assign( m_order.begin(), m_order.end() );
+	}
+
+	private:
+		std::vector< unsigned int > m_order;
+		std::vector< double > m_pt2s;
+		std::vector< double > m_scratch;
+
+		void Reorder( std::vector< double > & Values )
+		{
+			m_scratch.resize( Values.size() );
+			for ( unsigned int i = 0; i < Values.size(); i++ ) m_scratch[ i ] = Values[ m_order[ i ] ];
+			Values.swap( m_scratch );
+		}
+};
+
+//One event somewhere else in memory, such as a mapped binary event file, sorted pT high to low
+//perp2, rapidity and phi are null if they weren't worked out in advance, and exactKinematics says
+//whether libm or the approximate kernels made them. Each particle's nearest neighbour over the whole
+//event and the delta_R^2 to it are also null if they weren't worked out.
+struct ParticleView
+{
+	double const * px;
+	double const * py;
+	double const * pz;
+	double const * E;
+	double const * perp2;
+	double const * rapidity;
+	double const * phi;
+	double const * nearestDeltaR2;
+	unsigned int const * nearestNeighbour;
+	unsigned int particles;
+	bool exactKinematics;
+
+	ParticleView() : px( 0 ), py( 0 ), pz( 0 ), E( 0 ), perp2( 0 ), rapidity( 0 ), phi( 0 ), nearestDeltaR2( 0 ), nearestNeighbour( 0 ), particles( 0 ),
+		exactKinematics( false )
+	{
+	}
+	unsigned int size() const
+	{
+		return particles;
+	}
+};
+
+#endif
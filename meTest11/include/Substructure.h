@@ -0,0 +1,189 @@
+#ifndef SUBSTRUCTURE_H
+#define SUBSTRUCTURE_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+
+#include "FourMomentum.h"
+#include "ParticleArrays.h"
+#include "ClusterDispatch.h"
+#include "ClusterHistory.h"
+#include "JetConstituents.h"
+
+//Soft drop: undo the last merges of a jet's reclustered tree, each time keeping the harder branch,
+//until a splitting has min( pt1, pt2 ) / ( pt1 + pt2 ) > zCut ( delta_R12 / R0 )^beta
+//beta = 0 is the modified mass drop tagger
+struct SoftDropParameters
+{
+	double zCut;
+	double beta;
+	double R0;
+
+	SoftDropParameters( double ZCut = 0.1, double Beta = 0.0, double TheR0 = 0.6 ) : zCut( ZCut ), beta( Beta ), R0( TheR0 )
+	{
+	}
+};
+
+//What grooming one jet gave
+struct GroomedJet
+{
+	unsigned int jet; //which of the jets it was
+	FourMomentum groomed;
+	double zg; //momentum fraction of the splitting that passed, 0 if none did
+	double Rg; //and its opening angle
+	unsigned int dropped; //branches groomed away
+};
+
+//Room for a jet's constituents in fixed arrays, so copying them out for each jet never allocates
+//Bigger jets go in a ParticleArrays instead, which keeps its memory for the next one
+template< unsigned int CAPACITY >
+struct FixedParticleBuffer
+{
+	double px[ CAPACITY ];
+	double py[ CAPACITY ];
+	double pz[ CAPACITY ];
+	double E[ CAPACITY ];
+	unsigned int particles;
+
+	FixedParticleBuffer() : particles( 0 )
+	{
+	}
+
+	ParticleView View() const
+	{
+		ParticleView view;
+		view.px = px;
+		view.py = py;
+		view.pz = pz;
+		view.E = E;
+		view.particles = particles;
+		return view;
+	}
+};
+
+//Reclusters the constituents of every jet above a pT threshold with C/A or kt, one jet per TBB task,
+//and soft drops the result. Each thread has its own buffers, history and clustering workspace, all
+//kept between jets and events, so once they have seen the biggest jet nothing is allocated.
+//Groom can be called for several events at once, such as from inside a parallel loop over events.
+class SubstructureStage
+{
+	public:
+		static unsigned int const CAPACITY = 512;
+
+		//ReclusterP is 0 for C/A or 1 for kt
+		SubstructureStage( double ReclusterP = 0.0, SoftDropParameters const& SoftDrop = SoftDropParameters(), double MinPt = 0.0,
+				ClusterOptions const& Options = ClusterOptions() )
+			: m_recluster( ReclusterP, RECLUSTER_R ), m_softDrop( SoftDrop ), m_minPt( MinPt ), m_options( Options )
+		{
+			//A jet's clustering is one task, and mustn't wait on others while it holds its thread's buffers
+			m_options.parallelThreshold = 0;
+		}
+
+		//Results gets one entry for each of Jets above the threshold, in the same order
+		//Constituents are positions in Inputs, as the clusterer gives them
+		template< class Particles >
+		void Groom( Particles const& Inputs, std::vector< FourMomentum > const& Jets, JetConstituents const& Constituents, std::vector< GroomedJet > & Results )
+		{
+			unsigned int selected = 0;
+			for ( unsigned int jet = 0; jet < Jets.size(); jet++ ) selected += ( Jets[ jet ].Pt() >= m_minPt );
+			Results.resize( selected );
+			selected = 0;
+			for ( unsigned int jet = 0; jet < Jets.size(); jet++ )
+			{
+				if ( Jets[ jet ].Pt() >= m_minPt ) Results[ selected++ ].jet = jet;
+			}
+
+			tbb::parallel_for( tbb::blocked_range< unsigned int >( 0, Results.size(), 1 ), [&]( tbb::blocked_range< unsigned int > const& Range )
+			{
+				Buffers & buffers = m_buffers.local();
+				for ( unsigned int result = Range.begin(); result < Range.end(); result++ ) this->GroomJet( Inputs, Constituents, buffers, Results[ result ] );
+			} );
+		}
+
+	private:
+		//Big enough that every constituent pair is merged before anything goes to the beam, leaving one jet
+		static constexpr double RECLUSTER_R = 1000.0;
+
+		struct Buffers
+		{
+			FixedParticleBuffer< CAPACITY > particles;
+			ParticleArrays overflow;
+			ClusterWorkspace workspace;
+			ClusterHistory history;
+			std::vector< FourMomentum > subjets;
+		};
+
+		JetDefinition m_recluster;
+		SoftDropParameters m_softDrop;
+		double m_minPt;
+		ClusterOptions m_options;
+		tbb::enumerable_thread_specific< Buffers > m_buffers;
+
+		template< class Particles >
+		void GroomJet( Particles const& Inputs, JetConstituents const& Constituents, Buffers & TheBuffers, GroomedJet & Result ) const
+		{
+			//Recluster, keeping the history
+			unsigned int const total = Constituents.Count( Result.jet );
+			unsigned int const * const inputs = Constituents.Begin( Result.jet );
+			ClusterTiming timing;
+			TheBuffers.subjets.clear();
+			if ( total <= CAPACITY )
+			{
+				FixedParticleBuffer< CAPACITY > & particles = TheBuffers.particles;
+				for ( unsigned int i = 0; i < total; i++ )
+				{
+					particles.px[ i ] = Inputs.px[ inputs[ i ] ];
+					particles.py[ i ] = Inputs.py[ inputs[ i ] ];
+					particles.pz[ i ] = Inputs.pz[ inputs[ i ] ];
+					particles.E[ i ] = Inputs.E[ inputs[ i ] ];
+				}
+				particles.particles = total;
+				ClusterJets( m_recluster, m_options, TheBuffers.workspace, particles.View(), 0, TheBuffers.subjets, 0, &TheBuffers.history, 0, timing );
+			}
+			else
+			{
+				ParticleArrays & particles = TheBuffers.overflow;
+				particles.clear();
+				for ( unsigned int i = 0; i < total; i++ ) particles.push_back( Inputs.px[ inputs[ i ] ], Inputs.py[ inputs[ i ] ], Inputs.pz[ inputs[ i ] ], Inputs.E[ inputs[ i ] ] );
+				ClusterJets( m_recluster, m_options, TheBuffers.workspace, particles, 0, TheBuffers.subjets, 0, &TheBuffers.history, 0, timing );
+			}
+
+			//Decluster from the top of the tree, the object that went to the beam last
+			ClusterHistory const& history = TheBuffers.history;
+			Result.zg = 0.0;
+			Result.Rg = 0.0;
+			Result.dropped = 0;
+			if ( !history.size() )
+			{
+				Result.groomed = FourMomentum();
+				return;
+			}
+			unsigned int entry = history.Step( history.size() - 1 ).parent1;
+			while ( history.Step( entry ).type == ClusterStep::MERGE )
+			{
+				ClusterStep const& step = history.Step( entry );
+				FourMomentum const& first = history.Momentum( step.parent1 );
+				FourMomentum const& second = history.Momentum( step.parent2 );
+				double const firstPt = first.Pt();
+				double const secondPt = second.Pt();
+				double const deltaR = sqrt( DeltaR2( first.Phi(), first.Rapidity(), second.Phi(), second.Rapidity() ) );
+				double const z = std::min( firstPt, secondPt ) / ( firstPt + secondPt );
+				if ( z > m_softDrop.zCut * pow( deltaR / m_softDrop.R0, m_softDrop.beta ) )
+				{
+					Result.zg = z;
+					Result.Rg = deltaR;
+					break;
+				}
+				entry = ( firstPt >= secondPt ) ? step.parent1 : step.parent2;
+				Result.dropped++;
+			}
+			Result.groomed = history.Momentum( entry );
+		}
+};
+
+#endif
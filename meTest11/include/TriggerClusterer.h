@@ -0,0 +1,234 @@
+#ifndef TRIGGER_CLUSTERER_H
+#define TRIGGER_CLUSTERER_H
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+#include "FourMomentum.h"
+#include "KtAlgorithms.h"
+#include "ParticleArrays.h"
+#include "Clusterer.h"
+
+//Generalised kt for a software trigger: at most CAPACITY inputs, with every array a fixed-size member,
+//so clustering an event never allocates, throws or does I/O, and how long it takes is bounded by the
+//number of inputs alone.
+//The algorithm is the Clusterer's in double precision. The heap is replaced by a scan of the live
+//objects, which needs no memory of its own and below a few hundred objects costs no more than keeping
+//a heap. Ties still go to the lowest index, so given the inputs in the same order it makes exactly the
+//same jets in the same order. Nothing is sorted: the inputs are clustered in the order they come.
+//The neighbour and kinematics kernels come from the options; the precision, compaction and parallel
+//settings don't apply.
+//Worst case for N inputs:
+//  kinematics: N, then one per merge, so at most 2N - 1 objects
+//  minimum kt^2: N iterations, each a scan of at most N objects
+//  delta_R^2: N(N - 1) for the first neighbours, then each iteration at most N - 1 for the merged
+//  object's search, N - 1 to offer it to the others, and N - 1 for each object whose neighbour went.
+//  Seen from an object, any two objects that have it as their nearest neighbour are at least 60 degrees
+//  apart, so it is the nearest neighbour of at most 6. A merge then leaves at most 12 objects without
+//  their neighbour, and the total is 15 N(N - 1), WorstCasePairs. With inputs at exactly the same
+//  rapidity and phi the 6 doesn't hold, and the bound is N(N - 1)(N + 1), WorstCasePairsCoincident.
+//PairsEvaluated is what the last event took, to check against the bound.
+//The object is about 110 bytes per input of capacity. Keep it in static storage or as a member,
+//not on a small stack, and before C++17 new doesn't honour its alignment.
+template< class Algorithm, class Radius, unsigned int CAPACITY >
+class TriggerClusterer
+{
+	static_assert( CAPACITY > 0, "A trigger clusterer needs room for at least one input" );
+
+	public:
+		static unsigned int const Capacity = CAPACITY;
+
+		TriggerClusterer( Algorithm const& TheAlgorithm = Algorithm(), Radius const& TheRadius = Radius(), ClusterOptions const& Options = ClusterOptions() )
+			: m_algorithm( TheAlgorithm ), m_radius( TheRadius ), m_options( Options ), m_totalJets( 0 ), m_pairsEvaluated( 0 )
+		{
+		}
+
+		static constexpr unsigned long WorstCasePairs( unsigned int Inputs )
+		{
+			return 15ul * Inputs * ( Inputs ? Inputs - 1 : 0 );
+		}
+		static constexpr unsigned long WorstCasePairsCoincident( unsigned int Inputs )
+		{
+			return ( unsigned long )( Inputs ) * ( Inputs ? Inputs - 1 : 0 ) * ( Inputs + 1 );
+		}
+
+		//Inputs are a vector of four-vectors, ParticleArrays or a ParticleView
+		//Returns false without clustering anything if there are more than CAPACITY of them
+		template< class Particles >
+		bool Cluster( Particles const& Inputs ) noexcept
+		{
+			unsigned int const totalObjects = Inputs.size();
+			m_totalJets = 0;
+			m_pairsEvaluated = 0;
+			if ( totalObjects > CAPACITY ) return false;
+
+			//Kinematics of the whole event in one pass, weights holds pT^2 until it's turned into the weights
+			LoadMomenta( Inputs, m_pxs, m_pys, m_pzs, m_energies );
+			if ( !LoadKinematics( Inputs, m_options.kinematics, m_weights, m_rapidities, m_phis ) )
+			{
+				m_options.kinematics( m_pxs, m_pys, m_pzs, m_energies, 0, totalObjects, m_weights, m_rapidities, m_phis );
+			}
+			for ( unsigned int i = 0; i < totalObjects; i++ )
+			{
+				m_weights[ i ] = m_algorithm.Weight( m_weights[ i ] );
+				m_wasDeleted[ i ] = false;
+			}
+
+			unsigned int firstActive = 0;
+			unsigned int lastActive = totalObjects;
+
+			//The kt^2 an object would have with its nearest neighbour, or alone
+			auto updateKt2 = [&]( unsigned int thisObjectIndex )
+			{
+				unsigned int const neighbour = m_nearestNeighbours[ thisObjectIndex ];
+				double const thisWeight = m_weights[ thisObjectIndex ];
+				double kt2 = thisWeight;
+				if ( neighbour != thisObjectIndex )
+				{
+					double const pairKt2 = m_nearestDeltaR2s[ thisObjectIndex ] * m_radius.InverseR2() * Algorithm::PairWeight( thisWeight, m_weights[ neighbour ] );
+					if ( pairKt2 < kt2 ) kt2 = pairKt2;
+				}
+				m_cachedMinKts[ thisObjectIndex ] = kt2;
+			};
+
+			//Find the nearest neighbour of an object from all active objects, either side of it
+			auto findNeighbour = [&]( unsigned int thisObjectIndex )
+			{
+				double minDeltaR2 = DBL_MAX;
+				unsigned int minDeltaR2Pair = thisObjectIndex;
+				unsigned int const splitIndex = std::max( thisObjectIndex, firstActive );
+				unsigned int const afterIndex = std::max( thisObjectIndex + 1, firstActive );
+				m_options.kernel( m_phis[ thisObjectIndex ], m_rapidities[ thisObjectIndex ], m_phis, m_rapidities, m_wasDeleted,
+						firstActive, splitIndex, minDeltaR2, minDeltaR2Pair );
+				m_options.kernel( m_phis[ thisObjectIndex ], m_rapidities[ thisObjectIndex ], m_phis, m_rapidities, m_wasDeleted,
+						afterIndex, lastActive, minDeltaR2, minDeltaR2Pair );
+				m_pairsEvaluated += ( splitIndex - firstActive ) + ( lastActive - afterIndex );
+
+				m_nearestDeltaR2s[ thisObjectIndex ] = minDeltaR2;
+				m_nearestNeighbours[ thisObjectIndex ] = minDeltaR2Pair;
+				updateKt2( thisObjectIndex );
+			};
+
+			//Initial neighbours
+			for ( unsigned int thisObjectIndex = 0; thisObjectIndex < totalObjects; thisObjectIndex++ ) findNeighbour( thisObjectIndex );
+
+			for ( unsigned int activeObjects = totalObjects; activeObjects; activeObjects-- )
+			{
+				//Min kt^2 value over all objects, the lowest index on a tie
+				//The first in the range is always live, and deleted objects never win as their kt^2 is infinite
+				unsigned int thisMinIndex = firstActive;
+				double overallMinKt2 = m_cachedMinKts[ firstActive ];
+				for ( unsigned int thisObjectIndex = firstActive + 1; thisObjectIndex < lastActive; thisObjectIndex++ )
+				{
+					if ( m_cachedMinKts[ thisObjectIndex ] < overallMinKt2 )
+					{
+						overallMinKt2 = m_cachedMinKts[ thisObjectIndex ];
+						thisMinIndex = thisObjectIndex;
+					}
+				}
+
+				//Beam distance wins if it is no larger than the pair distance
+				unsigned int pairMinIndex = m_nearestNeighbours[ thisMinIndex ];
+				if ( overallMinKt2 == m_weights[ thisMinIndex ] ) pairMinIndex = thisMinIndex;
+				bool const isMerge = ( thisMinIndex != pairMinIndex );
+
+				//A jet is output, a merge replaces the first object of the pair
+				if ( !isMerge )
+				{
+					m_jets[ m_totalJets++ ] = FourMomentum( m_pxs[ thisMinIndex ], m_pys[ thisMinIndex ], m_pzs[ thisMinIndex ], m_energies[ thisMinIndex ] );
+				}
+				else
+				{
+					m_pxs[ thisMinIndex ] += m_pxs[ pairMinIndex ];
+					m_pys[ thisMinIndex ] += m_pys[ pairMinIndex ];
+					m_pzs[ thisMinIndex ] += m_pzs[ pairMinIndex ];
+					m_energies[ thisMinIndex ] += m_energies[ pairMinIndex ];
+					m_options.kinematics( m_pxs, m_pys, m_pzs, m_energies, thisMinIndex, thisMinIndex + 1, m_weights, m_rapidities, m_phis );
+					m_weights[ thisMinIndex ] = m_algorithm.Weight( m_weights[ thisMinIndex ] );
+				}
+				m_wasDeleted[ pairMinIndex ] = true;
+				m_cachedMinKts[ pairMinIndex ] = HUGE_VAL;
+
+				//Reduce the search range
+				while ( firstActive < lastActive && m_wasDeleted[ firstActive ] ) firstActive++;
+				while ( lastActive > firstActive && m_wasDeleted[ lastActive - 1 ] ) lastActive--;
+
+				//Objects that lost their neighbour need a full search, every other object only has to
+				//check whether the merged object is now closer
+				if ( isMerge ) findNeighbour( thisMinIndex );
+				for ( unsigned int thisObjectIndex = firstActive; thisObjectIndex < lastActive; thisObjectIndex++ )
+				{
+					if ( m_wasDeleted[ thisObjectIndex ] || thisObjectIndex == thisMinIndex ) continue;
+
+					unsigned int const neighbour = m_nearestNeighbours[ thisObjectIndex ];
+					if ( neighbour == pairMinIndex )
+					{
+						findNeighbour( thisObjectIndex );
+					}
+					else if ( isMerge )
+					{
+						double const mergedDeltaR2 = DeltaR2( m_phis[ thisObjectIndex ], m_rapidities[ thisObjectIndex ], m_phis[ thisMinIndex ], m_rapidities[ thisMinIndex ] );
+						m_pairsEvaluated++;
+						if ( neighbour == thisMinIndex )
+						{
+							//Still the nearest if it got closer, otherwise something else might be
+							if ( mergedDeltaR2 <= m_nearestDeltaR2s[ thisObjectIndex ] )
+							{
+								m_nearestDeltaR2s[ thisObjectIndex ] = mergedDeltaR2;
+								updateKt2( thisObjectIndex );
+							}
+							else
+							{
+								findNeighbour( thisObjectIndex );
+							}
+						}
+						else if ( mergedDeltaR2 < m_nearestDeltaR2s[ thisObjectIndex ] )
+						{
+							m_nearestDeltaR2s[ thisObjectIndex ] = mergedDeltaR2;
+							m_nearestNeighbours[ thisObjectIndex ] = thisMinIndex;
+							updateKt2( thisObjectIndex );
+						}
+					}
+				}
+			}
+			return true;
+		}
+
+		//The jets of the last event, in the order they were made
+		unsigned int JetCount() const
+		{
+			return m_totalJets;
+		}
+		FourMomentum const * Jets() const
+		{
+			return m_jets;
+		}
+		unsigned long PairsEvaluated() const
+		{
+			return m_pairsEvaluated;
+		}
+
+	private:
+		Algorithm m_algorithm;
+		Radius m_radius;
+		ClusterOptions m_options;
+
+		alignas( 64 ) double m_phis[ CAPACITY ];
+		alignas( 64 ) double m_rapidities[ CAPACITY ];
+		alignas( 64 ) double m_weights[ CAPACITY ];
+		alignas( 64 ) double m_pxs[ CAPACITY ];
+		alignas( 64 ) double m_pys[ CAPACITY ];
+		alignas( 64 ) double m_pzs[ CAPACITY ];
+		alignas( 64 ) double m_energies[ CAPACITY ];
+		alignas( 64 ) double m_nearestDeltaR2s[ CAPACITY ];
+		alignas( 64 ) double m_cachedMinKts[ CAPACITY ];
+		alignas( 64 ) unsigned int m_nearestNeighbours[ CAPACITY ];
+		alignas( 64 ) bool m_wasDeleted[ CAPACITY ];
+
+		FourMomentum m_jets[ CAPACITY ];
+		unsigned int m_totalJets;
+		unsigned long m_pairsEvaluated;
+};
+
+#endif
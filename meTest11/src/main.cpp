@@ -0,0 +1,644 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "tbb/tick_count.h"
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+#include "tbb/task_arena.h"
+#include "tbb/enumerable_thread_specific.h"
+
+#include "FourMomentum.h"
+#include "ClusterDispatch.h"
+#include "JetValidation.h"
+#include "EventReader.h"
+#include "MappedEventReader.h"
+#include "BinaryEventFile.h"
+#include "Substructure.h"
+#include "MultiRadius.h"
+
+using namespace std;
+using namespace tbb;
+
+bool SortJetsByPt( FourMomentum const& i, FourMomentum const& j )
+{
+	return ( i.Pt() > j.Pt() );
+}
+
+//Room to sort the jets of an event with their areas and constituents, kept for the next event
+struct JetSortBuffers
+{
+	vector< unsigned int > order;
+	vector< FourMomentum > jets;
+	vector< double > areas;
+	JetConstituents constituents;
+};
+
+void SortJets( vector< FourMomentum > & Jets )
+{
+	sort( Jets.begin(), Jets.end(), SortJetsByPt );
+}
+
+//Sort jets with their areas and constituents, if there are any
+//They are sorted into the buffers and copied back, so neither side allocates once the buffers have
+//seen the biggest event. Equal pT keeps the original order.
+void SortJets( vector< FourMomentum > & Jets, vector< double > & Areas, JetConstituents * Constituents, JetSortBuffers & Buffers )
+{
+	bool const withAreas = ( Areas.size() == Jets.size() );
+	bool const withConstituents = Constituents && Constituents->size() == Jets.size();
+	if ( !withAreas && !withConstituents )
+	{
+		SortJets( Jets );
+		return;
+	}
+	vector< unsigned int > & order = Buffers.order;
+	order.resize( Jets.size() );
+	for ( unsigned int i = 0; i < order.size(); i++ ) order[ i ] = i;
+	sort( order.begin(), order.end(), [&Jets]( unsigned int i, unsigned int j ){ return SortJetsByPt( Jets[ i ], Jets[ j ] ) || ( !SortJetsByPt( Jets[ j ], Jets[ i ] ) && i < j ); } );
+	Buffers.jets.resize( Jets.size() );
+	Buffers.areas.resize( withAreas ? Areas.size() : 0 );
+	Buffers.constituents.Clear();
+	if ( withConstituents ) Buffers.constituents.Reserve( Constituents->size(), Constituents->indices.size() );
+	for ( unsigned int i = 0; i < order.size(); i++ )
+	{
+		Buffers.jets[ i ] = Jets[ order[ i ] ];
+		if ( withAreas ) Buffers.areas[ i ] = Areas[ order[ i ] ];
+		if ( !withConstituents ) continue;
+		for ( unsigned int const * input = Constituents->Begin( order[ i ] ); input != Constituents->End( order[ i ] ); input++ ) Buffers.constituents.Add( *input );
+		Buffers.constituents.EndJet();
+	}
+	copy( Buffers.jets.begin(), Buffers.jets.end(), Jets.begin() );
+	if ( withAreas ) copy( Buffers.areas.begin(), Buffers.areas.end(), Areas.begin() );
+	if ( withConstituents )
+	{
+		copy( Buffers.constituents.offsets.begin(), Buffers.constituents.offsets.end(), Constituents->offsets.begin() );
+		copy( Buffers.constituents.indices.begin(), Buffers.constituents.indices.end(), Constituents->indices.begin() );
+	}
+}
+
+void PrintUsage( char const * Name )
+{
+	cerr << "Usage: " << Name << " [-a antikt|kt|cambridge|genkt] [-p exponent] [-R radius,...] [-k auto|scalar|sse4.2|avx2|avx512] [-K auto|exact|scalar|avx2|avx512] [-P double|float] [-c compaction threshold] [-v referenceOutput.txt] [-i input] [-e first event] [-T parallel threshold] [-A ghost max rapidity [-g ghost area]] [-x jets,...] [-d dcut,...] [-C] [-I] [-z zcut[,beta] [-m min pt] [-r cambridge|kt]] [-b [-t threads] [-j]] < input" << endl;
+	cerr << "  -R with several radii prepares each event once and clusters it at every radius in parallel, plain jets only: not with -A, -x, -d, -C, -I, -z or -v" << endl;
+	cerr << "  -K works out rapidity and phi with libm (exact) or vectorised approximations within 2 ulp" << endl;
+	cerr << "     kinematics stored in a binary file are only used if they came from the same kind, otherwise they're worked out again" << endl;
+	cerr << "  -T shares the work within an event between threads while it has at least that many objects" << endl;
+	cerr << "  -i reads a text or binary event file through a memory map instead of reading stdin" << endl;
+	cerr << "  -e starts from that event number, counting from 0" << endl;
+	cerr << "  -A works out active jet areas with a grid of ghosts out to that rapidity, each of about -g in area (default 0.005)" << endl;
+	cerr << "  -x and -d also print the exclusive jets for those multiplicities and dcuts, from the clustering history (kt and cambridge)" << endl;
+	cerr << "  -C keeps track of which inputs are in each jet and prints how many" << endl;
+	cerr << "  -I also lists them, as positions in the event as read from 0 (binary files are stored sorted, so positions in the file)" << endl;
+	cerr << "  -z soft drops every jet above -m in pT (default 0), reclustered with -r (default cambridge), R0 the jet radius" << endl;
+	cerr << "  -b clusters every event in the input and reports throughput instead of the jets of the first event" << endl;
+	cerr << "  -t runs that many events at once, 0 for one per core (default 1)" << endl;
+	cerr << "  -j also prints the jets of every event" << endl;
+}
+
+//Value of a sorted list below which Fraction of the entries lie
+double Percentile( vector< double > const& Sorted, double Fraction )
+{
+	if ( Sorted.empty() ) return 0.0;
+	unsigned int index = ( unsigned int )( Fraction * Sorted.size() );
+	if ( index >= Sorted.size() ) index = Sorted.size() - 1;
+	return Sorted[ index ];
+}
+
+//Output exactly like fastjet demo, with an area column like the fastjet area example if there are areas,
+//and the number of constituents if there are constituents
+void PrintJets( vector< FourMomentum > const& Jets, vector< double > const& Areas, JetConstituents const * Constituents = 0 )
+{
+	double const TWO_PI = 2.0 * M_PI;
+	bool const withAreas = !Areas.empty();
+	printf("%5s %15s %15s %15s","jet #", "rapidity", "phi", "pt");
+	if ( withAreas ) printf( " %15s", "area" );
+	printf( Constituents ? " %12s\n" : "\n", "constituents" );
+	for ( unsigned int jetIndex = 0; jetIndex < Jets.size(); jetIndex++ )
+	{
+		//if ( Jets[ jetIndex ].Pt() < 5.0 ) break;
+		double phi = Jets[ jetIndex ].Phi();
+		while ( phi < 0.0 ) phi += TWO_PI;
+		printf( "%5u %15.8f %15.8f %15.8f",
+				jetIndex,
+				Jets[ jetIndex ].Rapidity(),
+				phi,
+				Jets[ jetIndex ].Pt() );
+		if ( withAreas ) printf( " %15.8f", Areas[ jetIndex ] );
+		if ( Constituents ) printf( " %12u\n", Constituents->Count( jetIndex ) );
+		else printf( "\n" );
+	}
+}
+
+//The inputs of each jet in the same order as the jet table
+void PrintConstituents( JetConstituents const& Constituents )
+{
+	for ( unsigned int jetIndex = 0; jetIndex < Constituents.size(); jetIndex++ )
+	{
+		printf( "%5u constituents:", jetIndex );
+		for ( unsigned int const * input = Constituents.Begin( jetIndex ); input != Constituents.End( jetIndex ); input++ ) printf( " %u", *input );
+		printf( "\n" );
+	}
+}
+
+//Exclusive jets wanted from the clustering history
+struct ExclusiveQueries
+{
+	vector< unsigned int > multiplicities;
+	vector< double > dcuts;
+
+	bool empty() const
+	{
+		return multiplicities.empty() && dcuts.empty();
+	}
+};
+
+//Comma separated values, false if any of them isn't a number
+template< class Value >
+bool ParseList( string const& Text, vector< Value > & Values )
+{
+	istringstream list( Text );
+	string item;
+	while ( getline( list, item, ',' ) )
+	{
+		istringstream field( item );
+		Value value;
+		if ( !( field >> value ) ) return false;
+		Values.push_back( value );
+	}
+	return !Values.empty();
+}
+
+//Every query answered from one history, with the merging scale that gives each multiplicity
+void PrintExclusiveJets( ClusterHistory const& History, ExclusiveQueries const& Queries )
+{
+	vector< FourMomentum > jets;
+	vector< double > noAreas;
+	for ( unsigned int i = 0; i < Queries.multiplicities.size(); i++ )
+	{
+		unsigned int const multiplicity = Queries.multiplicities[ i ];
+		History.ExclusiveJets( multiplicity, jets );
+		SortJets( jets );
+		printf( "Exclusive jets: %lu for n = %u, dmerge %.8g, ymerge %.8g\n", jets.size(), multiplicity,
+				History.ExclusiveDmerge( multiplicity ), History.ExclusiveYmerge( multiplicity ) );
+		PrintJets( jets, noAreas );
+	}
+	for ( unsigned int i = 0; i < Queries.dcuts.size(); i++ )
+	{
+		History.ExclusiveJets( Queries.dcuts[ i ], jets );
+		SortJets( jets );
+		printf( "Exclusive jets: %lu for dcut = %.8g\n", jets.size(), Queries.dcuts[ i ] );
+		PrintJets( jets, noAreas );
+	}
+}
+
+//Soft drop results, like the jet table with the groomed jet and its splitting
+void PrintGroomedJets( vector< FourMomentum > const& Jets, vector< GroomedJet > const& Groomed )
+{
+	printf( "%5s %15s %15s %15s %15s %15s %7s\n", "jet #", "pt", "groomed pt", "groomed mass", "zg", "Rg", "dropped" );
+	for ( unsigned int i = 0; i < Groomed.size(); i++ )
+	{
+		GroomedJet const& groomed = Groomed[ i ];
+		printf( "%5u %15.8f %15.8f %15.8f %15.8f %15.8f %7u\n", groomed.jet, Jets[ groomed.jet ].Pt(), groomed.groomed.Pt(), groomed.groomed.M(),
+				groomed.zg, groomed.Rg, groomed.dropped );
+	}
+}
+
+//Jets for each radius, sorted
+void PrintMultiRadiusJets( vector< double > const& Radii, vector< vector< FourMomentum > > & Jets )
+{
+	vector< double > noAreas;
+	for ( unsigned int radius = 0; radius < Radii.size(); radius++ )
+	{
+		SortJets( Jets[ radius ] );
+		printf( "R = %g\n", Radii[ radius ] );
+		PrintJets( Jets[ radius ], noAreas );
+	}
+}
+
+//Sorting the input pT high to low gives a large speedup
+//Order, if given, gets where each sorted particle was read from, or is left empty if nothing moved
+void PrepareEvent( ParticleArrays & Particles, vector< unsigned int > * Order = 0 )
+{
+	Particles.SortByPt( Order );
+}
+//Binary event files are already sorted
+void PrepareEvent( ParticleView &, vector< unsigned int > * Order = 0 )
+{
+	if ( Order ) Order->clear();
+}
+
+//Constituents as positions in the event as it was read, rather than in the sorted copy that was clustered
+void ToInputPositions( JetConstituents & Constituents, vector< unsigned int > const& Order )
+{
+	if ( !Order.empty() ) Constituents.Renumber( Order.data() );
+}
+
+//Cluster the next event from the input, print the jets and compare them with the reference if there is one
+template< class Event, class Reader >
+int RunSingle( Reader & ReadNextEvent, JetDefinition const& Definition, ClusterOptions const& Options, GhostGrid const& Ghosts,
+		ExclusiveQueries const& Exclusive, bool WithConstituents, bool ListConstituents, SubstructureStage * Substructure, MultiRadiusClusterer * MultiRadius,
+		vector< ReferenceJet > const& Reference, string const& ReferenceName )
+{
+	//Read the fastjet example input
+	Event inputs;
+	vector< unsigned int > inputOrder;
+	vector< FourMomentum > outputs;
+	vector< double > areas;
+	tick_count const startReadingTime = tick_count::now();
+	ReadNextEvent( inputs );
+	tick_count::interval_t const readingTime = tick_count::now() - startReadingTime;
+
+	PrepareEvent( inputs, &inputOrder );
+
+	//Everything that doesn't depend on R once, then each radius
+	if ( MultiRadius )
+	{
+		PreparedEvent prepared;
+		vector< vector< FourMomentum > > radiusOutputs;
+		vector< ClusterTiming > timings;
+		tick_count const startTime = tick_count::now();
+		prepared.Prepare( inputs, Options );
+		tick_count::interval_t const preparationTime = tick_count::now() - startTime;
+		MultiRadius->Cluster( prepared, radiusOutputs, &timings );
+		tick_count::interval_t const totalTime = tick_count::now() - startTime;
+		cout << "Reading time: " << readingTime.seconds() << " sec" << endl;
+		cout << "Total time: " << totalTime.seconds() << " sec" << endl;
+		cout << "Preparation time: " << preparationTime.seconds() << " sec" << endl;
+		for ( unsigned int radius = 0; radius < timings.size(); radius++ )
+		{
+			cout << "Clustering time for R = " << MultiRadius->Radii()[ radius ] << ": " << timings[ radius ].totalTime.seconds() << " sec" << endl;
+		}
+		PrintMultiRadiusJets( MultiRadius->Radii(), radiusOutputs );
+		return 0;
+	}
+
+	//Make the jets
+	ClusterTiming timing;
+	ClusterWorkspace workspace;
+	ClusterHistory history;
+	JetConstituents constituents;
+	ClusterJets( Definition, Options, workspace, inputs, Ghosts.size() ? &Ghosts : 0, outputs, Ghosts.size() ? &areas : 0,
+			Exclusive.empty() ? 0 : &history, ( WithConstituents || Substructure ) ? &constituents : 0, timing );
+	cout << "Reading time: " << readingTime.seconds() << " sec" << endl;
+	cout << "Total time: " << timing.totalTime.seconds() << " sec" << endl;
+	cout << "Kt finding time: " << timing.findMinKtTime.seconds() << " sec" << endl;
+	cout << "Collection update time: " << timing.updateCollectionsTime.seconds() << " sec" << endl;
+	cout << "Heap update time: " << timing.heapUpdateTime.seconds() << " sec" << endl;
+	if ( Options.compactionThreshold > 0.0 ) cout << "Compaction time: " << timing.compactionTime.seconds() << " sec in " << timing.compactions << " compactions" << endl;
+	if ( Options.singlePrecision ) cout << "Double precision rechecks: " << timing.doublePrecisionRechecks << endl;
+	if ( COUNTERS ) timing.counters.Print();
+
+	JetSortBuffers sortBuffers;
+	SortJets( outputs, areas, &constituents, sortBuffers );
+
+	//Grooming reclusters from the sorted inputs, so the constituents are only renumbered after it
+	vector< GroomedJet > groomed;
+	tick_count const startGroomingTime = tick_count::now();
+	if ( Substructure ) Substructure->Groom( inputs, outputs, constituents, groomed );
+	tick_count::interval_t const groomingTime = tick_count::now() - startGroomingTime;
+	ToInputPositions( constituents, inputOrder );
+
+	PrintJets( outputs, areas, WithConstituents ? &constituents : 0 );
+	if ( ListConstituents ) PrintConstituents( constituents );
+	if ( !Exclusive.empty() && !Ghosts.size() ) PrintExclusiveJets( history, Exclusive );
+	if ( Substructure )
+	{
+		cout << "Soft drop time: " << groomingTime.seconds() << " sec" << endl;
+		PrintGroomedJets( outputs, groomed );
+	}
+
+	//Report any difference from the reference jets
+	if ( !ReferenceName.empty() )
+	{
+		unsigned int const differences = CompareWithReference( outputs, Reference );
+		printf( "%u differences from %lu jets in %s\n", differences, Reference.size(), ReferenceName.c_str() );
+		if ( differences ) return 2;
+	}
+
+	return 0;
+}
+
+//Cluster all events from the input, reusing the buffers
+//Events are read in chunks and each chunk is clustered in parallel, one event per task, with a
+//workspace per thread. Results are then used in the input order.
+template< class Event, class Reader >
+int RunBatch( Reader & ReadNextEvent, JetDefinition const& Definition, ClusterOptions const& Options, GhostGrid const& Ghosts,
+		ExclusiveQueries const& Exclusive, bool WithConstituents, bool ListConstituents, SubstructureStage * Substructure, MultiRadiusClusterer * MultiRadius,
+		int Threads, bool PrintEventJets )
+{
+	unsigned int const CHUNK_SIZE = 1024;
+	vector< Event > inputs( CHUNK_SIZE );
+	vector< vector< FourMomentum > > outputs( CHUNK_SIZE );
+	vector< vector< double > > areas( CHUNK_SIZE );
+	vector< ClusterHistory > histories( Exclusive.empty() ? 0 : CHUNK_SIZE );
+	vector< unsigned long > exclusiveJets( CHUNK_SIZE );
+	vector< JetConstituents > constituents( ( WithConstituents || Substructure ) ? CHUNK_SIZE : 0 );
+	vector< vector< unsigned int > > inputOrders( WithConstituents ? CHUNK_SIZE : 0 );
+	vector< vector< GroomedJet > > groomed( Substructure ? CHUNK_SIZE : 0 );
+	vector< PreparedEvent > prepared( MultiRadius ? CHUNK_SIZE : 0 );
+	vector< vector< vector< FourMomentum > > > radiusOutputs( MultiRadius ? CHUNK_SIZE : 0 );
+	vector< double > chunkLatencies( CHUNK_SIZE );
+	enumerable_thread_specific< ClusterWorkspace > workspaces;
+	enumerable_thread_specific< JetSortBuffers > sortBuffers;
+	enumerable_thread_specific< vector< FourMomentum > > exclusiveBuffers;
+	enumerable_thread_specific< ClusterCounters > counters;
+	task_arena arena( Threads > 0 ? Threads : task_arena::automatic );
+
+	vector< double > latencies;
+	unsigned long totalParticles = 0;
+	unsigned long totalJets = 0;
+	unsigned long totalExclusiveJets = 0;
+	unsigned long totalGroomed = 0;
+	unsigned long eventNumber = 0;
+	tick_count::interval_t clusteringTime;
+	tick_count::interval_t readingTime;
+
+	tick_count const startTime = tick_count::now();
+	while ( true )
+	{
+		tick_count const startReadingTime = tick_count::now();
+		unsigned int chunkEvents = 0;
+		while ( chunkEvents < CHUNK_SIZE && ReadNextEvent( inputs[ chunkEvents ] ) ) chunkEvents++;
+		readingTime += tick_count::now() - startReadingTime;
+		if ( !chunkEvents ) break;
+
+		tick_count const startChunkTime = tick_count::now();
+		arena.execute( [&]()
+		{
+			parallel_for( blocked_range< unsigned int >( 0, chunkEvents, 1 ), [&]( blocked_range< unsigned int > const& Range )
+			{
+				ClusterWorkspace & workspace = workspaces.local();
+				vector< FourMomentum > & jets = exclusiveBuffers.local();
+				for ( unsigned int eventIndex = Range.begin(); eventIndex < Range.end(); eventIndex++ )
+				{
+					tick_count const startEventTime = tick_count::now();
+					PrepareEvent( inputs[ eventIndex ], WithConstituents ? &inputOrders[ eventIndex ] : 0 );
+					if ( MultiRadius )
+					{
+						prepared[ eventIndex ].Prepare( inputs[ eventIndex ], Options );
+						MultiRadius->Cluster( prepared[ eventIndex ], radiusOutputs[ eventIndex ] );
+						chunkLatencies[ eventIndex ] = ( tick_count::now() - startEventTime ).seconds();
+						continue;
+					}
+					outputs[ eventIndex ].clear();
+					areas[ eventIndex ].clear();
+					if ( WithConstituents || Substructure ) constituents[ eventIndex ].Clear();
+					ClusterTiming timing;
+					ClusterJets( Definition, Options, workspace, inputs[ eventIndex ], Ghosts.size() ? &Ghosts : 0, outputs[ eventIndex ], Ghosts.size() ? &areas[ eventIndex ] : 0,
+							Exclusive.empty() ? 0 : &histories[ eventIndex ], ( WithConstituents || Substructure ) ? &constituents[ eventIndex ] : 0, timing );
+
+					//Jets to print are sorted here, so the groomed jets refer to them in that order
+					if ( PrintEventJets ) SortJets( outputs[ eventIndex ], areas[ eventIndex ], constituents.empty() ? 0 : &constituents[ eventIndex ], sortBuffers.local() );
+					if ( Substructure ) Substructure->Groom( inputs[ eventIndex ], outputs[ eventIndex ], constituents[ eventIndex ], groomed[ eventIndex ] );
+					if ( WithConstituents ) ToInputPositions( constituents[ eventIndex ], inputOrders[ eventIndex ] );
+
+					//The queries are part of the time, as an analysis would make them
+					exclusiveJets[ eventIndex ] = 0;
+					for ( unsigned int i = 0; !Ghosts.size() && i < Exclusive.multiplicities.size(); i++ )
+					{
+						histories[ eventIndex ].ExclusiveJets( Exclusive.multiplicities[ i ], jets );
+						exclusiveJets[ eventIndex ] += jets.size();
+					}
+					for ( unsigned int i = 0; !Ghosts.size() && i < Exclusive.dcuts.size(); i++ )
+					{
+						histories[ eventIndex ].ExclusiveJets( Exclusive.dcuts[ i ], jets );
+						exclusiveJets[ eventIndex ] += jets.size();
+					}
+					if ( COUNTERS ) counters.local() += timing.counters;
+					chunkLatencies[ eventIndex ] = ( tick_count::now() - startEventTime ).seconds();
+				}
+			} );
+		} );
+		clusteringTime += tick_count::now() - startChunkTime;
+
+		//Results in the original order
+		for ( unsigned int eventIndex = 0; eventIndex < chunkEvents; eventIndex++ )
+		{
+			latencies.push_back( chunkLatencies[ eventIndex ] );
+			totalParticles += inputs[ eventIndex ].size();
+			totalJets += outputs[ eventIndex ].size();
+			for ( unsigned int radius = 0; MultiRadius && radius < radiusOutputs[ eventIndex ].size(); radius++ ) totalJets += radiusOutputs[ eventIndex ][ radius ].size();
+			totalExclusiveJets += exclusiveJets[ eventIndex ];
+			if ( Substructure ) totalGroomed += groomed[ eventIndex ].size();
+			if ( PrintEventJets && MultiRadius )
+			{
+				cout << "Event " << eventNumber << endl;
+				PrintMultiRadiusJets( MultiRadius->Radii(), radiusOutputs[ eventIndex ] );
+			}
+			else if ( PrintEventJets )
+			{
+				cout << "Event " << eventNumber << endl;
+				PrintJets( outputs[ eventIndex ], areas[ eventIndex ], WithConstituents ? &constituents[ eventIndex ] : 0 );
+				if ( ListConstituents ) PrintConstituents( constituents[ eventIndex ] );
+				if ( !Exclusive.empty() && !Ghosts.size() ) PrintExclusiveJets( histories[ eventIndex ], Exclusive );
+				if ( Substructure ) PrintGroomedJets( outputs[ eventIndex ], groomed[ eventIndex ] );
+			}
+			eventNumber++;
+		}
+	}
+	double const wallTime = ( tick_count::now() - startTime ).seconds();
+
+	unsigned int growths = 0;
+	for ( enumerable_thread_specific< ClusterWorkspace >::const_iterator workspace = workspaces.begin(); workspace != workspaces.end(); ++workspace )
+	{
+		growths += workspace->Growths();
+	}
+
+	sort( latencies.begin(), latencies.end() );
+	double const seconds = clusteringTime.seconds();
+	cout << "Events: " << latencies.size() << ", particles: " << totalParticles << ", jets: " << totalJets << endl;
+	if ( !Exclusive.empty() ) cout << "Exclusive jets: " << totalExclusiveJets << endl;
+	if ( Substructure ) cout << "Groomed jets: " << totalGroomed << endl;
+	cout << "Threads: " << arena.max_concurrency() << endl;
+	cout << "Clustering time: " << seconds << " sec (" << wallTime << " sec including reading)" << endl;
+	cout << "Reading time: " << readingTime.seconds() << " sec" << endl;
+	if ( seconds > 0.0 ) cout << "Throughput: " << latencies.size() / seconds << " events/sec, " << totalParticles / seconds << " particles/sec" << endl;
+	cout << "Event time percentiles: 50% " << Percentile( latencies, 0.5 ) * 1000.0
+		<< " ms, 90% " << Percentile( latencies, 0.9 ) * 1000.0
+		<< " ms, 99% " << Percentile( latencies, 0.99 ) * 1000.0
+		<< " ms, max " << Percentile( latencies, 1.0 ) * 1000.0 << " ms" << endl;
+	cout << "Workspace allocations: " << growths << " in " << workspaces.size() << " workspaces" << endl;
+	if ( COUNTERS )
+	{
+		ClusterCounters total;
+		for ( enumerable_thread_specific< ClusterCounters >::const_iterator threadCounters = counters.begin(); threadCounters != counters.end(); ++threadCounters )
+		{
+			total += *threadCounters;
+		}
+		total.Print();
+	}
+	return 0;
+}
+
+//Try to make some jets myself
+int main( int argc, char * argv[] )
+{
+	//Default to akt 0.6, like the fastjet example
+	JetDefinition definition;
+	ClusterOptions options;
+	string kernelName = "auto";
+	string kinematicsName = "auto";
+	string referenceName;
+	string inputName;
+	unsigned long firstEvent = 0;
+	double ghostMaxRapidity = 0.0;
+	double ghostArea = 0.005;
+	ExclusiveQueries exclusive;
+	bool batch = false;
+	bool printEventJets = false;
+	bool withConstituents = false;
+	bool listConstituents = false;
+	vector< double > softDrop;
+	double groomingMinPt = 0.0;
+	double reclusterP = 0.0;
+	vector< double > radii;
+	int threads = 1;
+	for ( int argIndex = 1; argIndex < argc; argIndex++ )
+	{
+		string const arg = argv[ argIndex ];
+		if ( arg == "-b" )
+		{
+			batch = true;
+			continue;
+		}
+		if ( arg == "-j" )
+		{
+			printEventJets = true;
+			continue;
+		}
+		if ( arg == "-C" )
+		{
+			withConstituents = true;
+			continue;
+		}
+		if ( arg == "-I" )
+		{
+			withConstituents = true;
+			listConstituents = true;
+			continue;
+		}
+		if ( argIndex + 1 >= argc )
+		{
+			PrintUsage( argv[ 0 ] );
+			return 1;
+		}
+		string const value = argv[ ++argIndex ];
+		if ( arg == "-a" )
+		{
+			if ( value == "antikt" ) definition.p = -1.0;
+			else if ( value == "kt" ) definition.p = 1.0;
+			else if ( value == "cambridge" ) definition.p = 0.0;
+			else if ( value == "genkt" ) definition.p = 0.5;
+			else
+			{
+				PrintUsage( argv[ 0 ] );
+				return 1;
+			}
+		}
+		else if ( arg == "-p" ) definition.p = atof( value.c_str() );
+		else if ( arg == "-R" && ParseList( value, radii ) ) definition.R = radii[ 0 ];
+		else if ( arg == "-k" ) kernelName = value;
+		else if ( arg == "-K" ) kinematicsName = value;
+		else if ( arg == "-P" && ( value == "double" || value == "float" ) ) options.singlePrecision = ( value == "float" );
+		else if ( arg == "-v" ) referenceName = value;
+		else if ( arg == "-i" ) inputName = value;
+		else if ( arg == "-e" ) firstEvent = strtoul( value.c_str(), 0, 10 );
+		else if ( arg == "-c" ) options.compactionThreshold = atof( value.c_str() );
+		else if ( arg == "-t" ) threads = atoi( value.c_str() );
+		else if ( arg == "-T" ) options.parallelThreshold = atoi( value.c_str() );
+		else if ( arg == "-A" ) ghostMaxRapidity = atof( value.c_str() );
+		else if ( arg == "-g" && atof( value.c_str() ) > 0.0 ) ghostArea = atof( value.c_str() );
+		else if ( arg == "-x" && ParseList( value, exclusive.multiplicities ) ) continue;
+		else if ( arg == "-d" && ParseList( value, exclusive.dcuts ) ) continue;
+		else if ( arg == "-z" && ParseList( value, softDrop ) && softDrop.size() <= 2 ) continue;
+		else if ( arg == "-m" ) groomingMinPt = atof( value.c_str() );
+		else if ( arg == "-r" && ( value == "cambridge" || value == "kt" ) ) reclusterP = ( value == "kt" ) ? 1.0 : 0.0;
+		else
+		{
+			PrintUsage( argv[ 0 ] );
+			return 1;
+		}
+	}
+	if ( radii.size() > 1 && ( ghostMaxRapidity > 0.0 || !exclusive.empty() || withConstituents || !softDrop.empty() || !referenceName.empty() ) )
+	{
+		cerr << "Several radii only make plain jets, without areas, exclusive jets, constituents, soft drop or checks" << endl;
+		PrintUsage( argv[ 0 ] );
+		return 1;
+	}
+
+	//Nearest neighbour kernel for this CPU
+	options.kernel = SelectNearestNeighbourKernel( kernelName );
+	options.floatKernel = SelectNearestNeighbourKernelFloat( kernelName, &kernelName );
+	if ( !options.kernel || !options.floatKernel )
+	{
+		cerr << "Kernel " << kernelName << " is not available" << endl;
+		return 1;
+	}
+	options.kinematics = SelectKinematicsKernel( kinematicsName, &kinematicsName );
+	if ( !options.kinematics )
+	{
+		cerr << "Kinematics kernel " << kinematicsName << " is not available" << endl;
+		return 1;
+	}
+
+	//Jets to check against
+	vector< ReferenceJet > reference;
+	if ( !referenceName.empty() && !ReadReferenceJets( referenceName, reference ) )
+	{
+		cerr << "Can't read " << referenceName << endl;
+		return 1;
+	}
+
+	ostringstream radiusText;
+	radiusText << definition.R;
+	for ( unsigned int radius = 1; radius < radii.size(); radius++ ) radiusText << "," << radii[ radius ];
+	cout << "Algorithm: " << AlgorithmName( definition ) << " with p = " << definition.p << ", R = " << radiusText.str() << ", " << kernelName << " kernel, "
+		<< kinematicsName << " kinematics, " << ( options.singlePrecision ? "float" : "double" ) << endl;
+	GhostGrid const ghosts( ghostMaxRapidity, ghostArea );
+	if ( ghosts.size() ) cout << "Ghosts: " << ghosts.size() << " for |y| < " << ghosts.maxRapidity << ", " << ghosts.CellArea() << " each" << endl;
+	if ( ghosts.size() && !exclusive.empty() ) cerr << "No exclusive jets with ghosts, the clustering stops once the real particles are in jets" << endl;
+
+	//Grooming after the clustering
+	SubstructureStage substructure( reclusterP, SoftDropParameters( softDrop.empty() ? 0.0 : softDrop[ 0 ], softDrop.size() > 1 ? softDrop[ 1 ] : 0.0, definition.R ),
+			groomingMinPt, options );
+	SubstructureStage * const grooming = softDrop.empty() ? 0 : &substructure;
+	if ( grooming ) cout << "Soft drop: zcut " << softDrop[ 0 ] << ", beta " << ( softDrop.size() > 1 ? softDrop[ 1 ] : 0.0 ) << ", reclustered with "
+		<< ( reclusterP == 1.0 ? Kt::Name() : CambridgeAachen::Name() ) << " for jets above " << groomingMinPt << " GeV" << endl;
+
+	//Several radii at once
+	MultiRadiusClusterer multiRadius( definition.p, radii, options );
+	MultiRadiusClusterer * const multiRadiusClustering = ( radii.size() > 1 ) ? &multiRadius : 0;
+
+	//Binary event files are used in place, through the index
+	BinaryEventReader binaryInput( inputName );
+	if ( binaryInput.IsOpen() )
+	{
+		binaryInput.Seek( firstEvent );
+		auto readNextEvent = [&]( ParticleView & Particles )
+		{
+			return binaryInput.ReadEvent( Particles );
+		};
+		if ( batch ) return RunBatch< ParticleView >( readNextEvent, definition, options, ghosts, exclusive, withConstituents, listConstituents, grooming, multiRadiusClustering, threads, printEventJets );
+		return RunSingle< ParticleView >( readNextEvent, definition, options, ghosts, exclusive, withConstituents, listConstituents, grooming, multiRadiusClustering, reference, referenceName );
+	}
+
+	//Text events from stdin or a mapped file
+	MappedEventReader mappedInput( inputName );
+	if ( !inputName.empty() && !mappedInput.IsOpen() )
+	{
+		cerr << "Can't read " << inputName << endl;
+		return 1;
+	}
+	auto readNextEvent = [&]( ParticleArrays & Particles )
+	{
+		return inputName.empty() ? ReadEvent( cin, Particles ) : mappedInput.ReadEvent( Particles );
+	};
+	ParticleArrays skipped;
+	for ( unsigned long event = 0; event < firstEvent; event++ ) readNextEvent( skipped );
+	if ( batch ) return RunBatch< ParticleArrays >( readNextEvent, definition, options, ghosts, exclusive, withConstituents, listConstituents, grooming, multiRadiusClustering, threads, printEventJets );
+	return RunSingle< ParticleArrays >( readNextEvent, definition, options, ghosts, exclusive, withConstituents, listConstituents, grooming, multiRadiusClustering, reference, referenceName );
+}
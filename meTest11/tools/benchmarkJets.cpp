@@ -0,0 +1,451 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <random>
+
+#include <unistd.h>
+
+#include "FourMomentum.h"
+#include "ParticleArrays.h"
+#include "MappedEventReader.h"
+#include "ClusterDispatch.h"
+#include "JetValidation.h"
+
+using namespace std;
+
+//Every clustering strategy in the repository timed the same way on the same events: anti-kt R = 0.6
+//on the fastjet single event, the pileup event, and N particles drawn from the pileup event.
+//Each run is checked against the fastjet output where there is one, and otherwise against Test11
+//with exact kinematics and the scalar kernel, which matches fastjet on both of those.
+//test11-area also clusters a grid of ghosts for the jet areas. The ghosts don't change the real jets,
+//so it is checked the same way, and its time is what the areas cost on top.
+
+//One way of making jets
+class BenchmarkStrategy
+{
+	public:
+		virtual ~BenchmarkStrategy()
+		{
+		}
+
+		virtual string Name() const = 0;
+
+		//Jets softer than this aren't reported, so aren't compared
+		virtual double PtCut() const
+		{
+			return 0.0;
+		}
+
+		//Ghosts added for jet areas, if any
+		virtual unsigned int Ghosts() const
+		{
+			return 0;
+		}
+
+		//Cluster an event sorted pT high to low, giving the jets as a table sorted pT high to low
+		//and the clustering time. Returns false if it didn't run.
+		virtual bool Run( ParticleArrays const& Event, string const& EventFileName, vector< ReferenceJet > & Jets, double & Seconds ) = 0;
+};
+
+//Test11 in this process, with some choice of options, and active areas if there is a ghost grid
+class ClustererStrategy : public BenchmarkStrategy
+{
+	public:
+		ClustererStrategy( string const& Name, ClusterOptions const& Options, GhostGrid const& Ghosts = GhostGrid() ) : m_name( Name ), m_options( Options ), m_ghosts( Ghosts )
+		{
+		}
+
+		string Name() const
+		{
+			return m_name;
+		}
+
+		unsigned int Ghosts() const
+		{
+			return m_ghosts.size();
+		}
+
+		bool Run( ParticleArrays const& Event, string const&, vector< ReferenceJet > & Jets, double & Seconds )
+		{
+			ClusterTiming timing;
+			m_jets.clear();
+			m_areas.clear();
+			if ( m_ghosts.size() ) ClusterJets( JetDefinition(), m_options, m_workspace, Event, m_ghosts, m_jets, m_areas, timing );
+			else ClusterJets( JetDefinition(), m_options, m_workspace, Event, m_jets, timing );
+			Seconds = timing.totalTime.seconds();
+
+			Jets.clear();
+			for ( unsigned int jetIndex = 0; jetIndex < m_jets.size(); jetIndex++ ) Jets.push_back( JetRow( m_jets[ jetIndex ], m_areas.empty() ? 0.0 : m_areas[ jetIndex ] ) );
+			sort( Jets.begin(), Jets.end(), []( ReferenceJet const& i, ReferenceJet const& j ) { return i.pt > j.pt; } );
+			return true;
+		}
+
+	private:
+		string m_name;
+		ClusterOptions m_options;
+		GhostGrid m_ghosts;
+		ClusterWorkspace m_workspace;
+		vector< FourMomentum > m_jets;
+		vector< double > m_areas;
+};
+
+//One of the earlier tests, run as its own program on the event in a text file
+//They all read stdin and print "Total time" and the jet table, so that's all this relies on
+class ProgramStrategy : public BenchmarkStrategy
+{
+	public:
+		ProgramStrategy( string const& Name, string const& Executable, double PtCut ) : m_name( Name ), m_executable( Executable ), m_ptCut( PtCut )
+		{
+		}
+
+		string Name() const
+		{
+			return m_name;
+		}
+
+		double PtCut() const
+		{
+			return m_ptCut;
+		}
+
+		bool Run( ParticleArrays const&, string const& EventFileName, vector< ReferenceJet > & Jets, double & Seconds )
+		{
+			string const command = "'" + m_executable + "' < '" + EventFileName + "'";
+			FILE * const program = popen( command.c_str(), "r" );
+			if ( !program ) return false;
+
+			string output;
+			char buffer[ 4096 ];
+			size_t bytes;
+			while ( ( bytes = fread( buffer, 1, sizeof( buffer ), program ) ) > 0 ) output.append( buffer, bytes );
+			if ( pclose( program ) != 0 ) return false;
+
+			size_t const timeLine = output.find( "Total time: " );
+			if ( timeLine == string::npos ) return false;
+			Seconds = atof( output.c_str() + timeLine + strlen( "Total time: " ) );
+
+			Jets.clear();
+			istringstream table( output );
+			ReadJetTable( table, Jets );
+			return true;
+		}
+
+	private:
+		string m_name;
+		string m_executable;
+		double m_ptCut;
+};
+
+//An event to time everything on, with the jets it should give
+struct BenchmarkEvent
+{
+	string name;
+	ParticleArrays particles;
+	vector< ReferenceJet > reference;
+	string referenceName;
+	string fileName;
+};
+
+//Value of a sorted list below which Fraction of the entries lie
+double Percentile( vector< double > const& Sorted, double Fraction )
+{
+	if ( Sorted.empty() ) return 0.0;
+	unsigned int index = ( unsigned int )( Fraction * Sorted.size() );
+	if ( index >= Sorted.size() ) index = Sorted.size() - 1;
+	return Sorted[ index ];
+}
+
+//Count particles drawn from Source without replacement, in a fixed order for a given seed
+//Beyond the size of Source, further copies are rotated in phi by the golden angle so they
+//don't sit on top of the originals
+void SampleParticles( ParticleArrays const& Source, unsigned int Count, unsigned int Seed, ParticleArrays & Sample )
+{
+	double const GOLDEN_ANGLE = M_PI * ( 3.0 - sqrt( 5.0 ) );
+	unsigned int const total = Source.size();
+	mt19937 generator( Seed );
+	vector< unsigned int > order( total );
+	for ( unsigned int i = 0; i < total; i++ ) order[ i ] = i;
+	for ( unsigned int i = total - 1; i > 0; i-- ) swap( order[ i ], order[ generator() % ( i + 1 ) ] );
+
+	Sample.clear();
+	for ( unsigned int i = 0; i < Count; i++ )
+	{
+		unsigned int const index = order[ i % total ];
+		double const angle = GOLDEN_ANGLE * ( i / total );
+		double const cosine = cos( angle );
+		double const sine = sin( angle );
+		Sample.push_back( ( Source.px[ index ] * cosine ) - ( Source.py[ index ] * sine ),
+				( Source.px[ index ] * sine ) + ( Source.py[ index ] * cosine ),
+				Source.pz[ index ], Source.E[ index ] );
+	}
+}
+
+//Read the first event of a text file, false if it can't be read
+bool ReadFirstEvent( string const& FileName, ParticleArrays & Particles )
+{
+	MappedEventReader input( FileName );
+	return input.IsOpen() && input.ReadEvent( Particles ) && Particles.size();
+}
+
+//Write an event for the programs to read, at full precision so they see the same numbers
+bool WriteEventFile( BenchmarkEvent & Event )
+{
+	char fileName[] = "/tmp/benchmarkJetsXXXXXX";
+	int const file = mkstemp( fileName );
+	if ( file < 0 ) return false;
+	FILE * const output = fdopen( file, "w" );
+	for ( unsigned int i = 0; i < Event.particles.size(); i++ )
+	{
+		fprintf( output, "%.17g %.17g %.17g %.17g\n", Event.particles.px[ i ], Event.particles.py[ i ], Event.particles.pz[ i ], Event.particles.E[ i ] );
+	}
+	Event.fileName = fileName;
+	return ( fclose( output ) == 0 );
+}
+
+//Comma separated list
+vector< string > SplitList( string const& List )
+{
+	vector< string > items;
+	istringstream input( List );
+	string item;
+	while ( getline( input, item, ',' ) ) if ( !item.empty() ) items.push_back( item );
+	return items;
+}
+
+void PrintUsage( char const * Name )
+{
+	cerr << "Usage: " << Name << " [-i pileup.dat] [-d directory of meTest*] [-s strategy,...] [-n particles,...] [-w warm-up runs] [-r timed runs] [-B budget] [-S seed] [-A ghost max rapidity] [-g ghost area] [-f csv|json] [-l]" << endl;
+	cerr << "  Run from meTest11, which has the event files and their fastjet jets" << endl;
+	cerr << "  -n sizes to draw from the pileup event, default 100,200,500,1000,2000,5000,10000,20000,50000,100000" << endl;
+	cerr << "  -B stops timing a strategy on bigger events once its median is over this many seconds (default 1)" << endl;
+	cerr << "  -A and -g set the ghost grid of test11-area, which also reports jet areas (default 5 and 0.005)" << endl;
+	cerr << "  -l lists the strategies" << endl;
+}
+
+int main( int argc, char * argv[] )
+{
+	string pileupName = "Pythia-Z2jets-lhc-pileup-1ev.allSmushedTogether.dat";
+	string programDirectory = "..";
+	string strategyList;
+	string sizeList = "100,200,500,1000,2000,5000,10000,20000,50000,100000";
+	unsigned int warmUps = 1;
+	unsigned int repetitions = 5;
+	double budget = 1.0;
+	unsigned int seed = 1;
+	double ghostMaxRapidity = 5.0;
+	double ghostArea = 0.005;
+	string format = "csv";
+	bool listOnly = false;
+	for ( int argIndex = 1; argIndex < argc; argIndex++ )
+	{
+		string const arg = argv[ argIndex ];
+		if ( arg == "-l" )
+		{
+			listOnly = true;
+			continue;
+		}
+		if ( argIndex + 1 >= argc )
+		{
+			PrintUsage( argv[ 0 ] );
+			return 1;
+		}
+		string const value = argv[ ++argIndex ];
+		if ( arg == "-i" ) pileupName = value;
+		else if ( arg == "-d" ) programDirectory = value;
+		else if ( arg == "-s" ) strategyList = value;
+		else if ( arg == "-n" ) sizeList = value;
+		else if ( arg == "-w" ) warmUps = atoi( value.c_str() );
+		else if ( arg == "-r" && atoi( value.c_str() ) > 0 ) repetitions = atoi( value.c_str() );
+		else if ( arg == "-B" ) budget = atof( value.c_str() );
+		else if ( arg == "-S" ) seed = atoi( value.c_str() );
+		else if ( arg == "-A" && atof( value.c_str() ) > 0.0 ) ghostMaxRapidity = atof( value.c_str() );
+		else if ( arg == "-g" && atof( value.c_str() ) > 0.0 ) ghostArea = atof( value.c_str() );
+		else if ( arg == "-f" && ( value == "csv" || value == "json" ) ) format = value;
+		else
+		{
+			PrintUsage( argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	//Everything that can run here: the earlier tests if they have been built, then Test11 variations
+	//Tests 3 to 5 only print jets above 5 GeV
+	vector< unique_ptr< BenchmarkStrategy > > strategies;
+	for ( unsigned int test = 1; test <= 10; test++ )
+	{
+		string const executable = programDirectory + "/meTest" + to_string( test ) + "/bin/benJet";
+		double const ptCut = ( test >= 3 && test <= 5 ) ? 5.0 : 0.0;
+		if ( access( executable.c_str(), X_OK ) == 0 ) strategies.emplace_back( new ProgramStrategy( "test" + to_string( test ), executable, ptCut ) );
+	}
+	ClusterOptions scalar;
+	scalar.kernel = SelectNearestNeighbourKernel( "scalar" );
+	scalar.floatKernel = SelectNearestNeighbourKernelFloat( "scalar" );
+	scalar.kinematics = SelectKinematicsKernel( "exact" );
+	strategies.emplace_back( new ClustererStrategy( "test11-scalar", scalar ) );
+	char const * const KERNELS[] = { "sse4.2", "avx2", "avx512" };
+	for ( char const * kernel : KERNELS )
+	{
+		ClusterOptions options = scalar;
+		options.kernel = SelectNearestNeighbourKernel( kernel );
+		if ( options.kernel ) strategies.emplace_back( new ClustererStrategy( string( "test11-" ) + kernel, options ) );
+	}
+	ClusterOptions best;
+	strategies.emplace_back( new ClustererStrategy( "test11", best ) );
+	best.singlePrecision = true;
+	strategies.emplace_back( new ClustererStrategy( "test11-float", best ) );
+	best.compactionThreshold = 0.5;
+	strategies.emplace_back( new ClustererStrategy( "test11-float-compaction", best ) );
+	strategies.emplace_back( new ClustererStrategy( "test11-area", ClusterOptions(), GhostGrid( ghostMaxRapidity, ghostArea ) ) );
+
+	if ( listOnly )
+	{
+		for ( unsigned int i = 0; i < strategies.size(); i++ ) cout << strategies[ i ]->Name() << endl;
+		return 0;
+	}
+	if ( !strategyList.empty() )
+	{
+		vector< string > const wanted = SplitList( strategyList );
+		vector< unique_ptr< BenchmarkStrategy > > chosen;
+		for ( unsigned int i = 0; i < wanted.size(); i++ )
+		{
+			unsigned int index = 0;
+			while ( index < strategies.size() && ( !strategies[ index ] || strategies[ index ]->Name() != wanted[ i ] ) ) index++;
+			if ( index == strategies.size() )
+			{
+				cerr << "No strategy " << wanted[ i ] << ", -l lists them" << endl;
+				return 1;
+			}
+			chosen.push_back( move( strategies[ index ] ) );
+		}
+		strategies.swap( chosen );
+	}
+
+	//Events smallest first, so a strategy that runs over budget can skip the rest
+	ParticleArrays pileup;
+	if ( !ReadFirstEvent( pileupName, pileup ) )
+	{
+		cerr << "Can't read " << pileupName << endl;
+		return 1;
+	}
+	vector< BenchmarkEvent > events;
+	events.push_back( BenchmarkEvent() );
+	events.back().name = "single";
+	events.back().referenceName = "referenceOutput.txt";
+	if ( !ReadFirstEvent( "single-event.dat", events.back().particles ) || !ReadReferenceJets( events.back().referenceName, events.back().reference ) )
+	{
+		cerr << "Can't read single-event.dat and referenceOutput.txt, leaving out the single event" << endl;
+		events.pop_back();
+	}
+	events.push_back( BenchmarkEvent() );
+	events.back().name = "pileup";
+	events.back().particles = pileup;
+	events.back().referenceName = "fullDetailHugeEvent.txt";
+	if ( !ReadReferenceJets( events.back().referenceName, events.back().reference ) ) events.back().referenceName.clear();
+	vector< string > const sizes = SplitList( sizeList );
+	for ( unsigned int i = 0; i < sizes.size(); i++ )
+	{
+		events.push_back( BenchmarkEvent() );
+		events.back().name = "sample";
+		SampleParticles( pileup, strtoul( sizes[ i ].c_str(), 0, 10 ), seed, events.back().particles );
+	}
+	stable_sort( events.begin(), events.end(), []( BenchmarkEvent const& i, BenchmarkEvent const& j ) { return i.particles.size() < j.particles.size(); } );
+
+	//Sorted inputs, a file for the programs, and jets to check against
+	ClustererStrategy referenceStrategy( "reference", scalar );
+	for ( unsigned int i = 0; i < events.size(); i++ )
+	{
+		BenchmarkEvent & event = events[ i ];
+		event.particles.SortByPt();
+		if ( !WriteEventFile( event ) )
+		{
+			cerr << "Can't write a temporary event file" << endl;
+			return 1;
+		}
+		if ( event.referenceName.empty() )
+		{
+			double seconds;
+			referenceStrategy.Run( event.particles, event.fileName, event.reference, seconds );
+			event.referenceName = "test11-scalar";
+		}
+	}
+
+	if ( format == "csv" ) cout << "strategy,event,particles,jets,differences,reference,warmups,runs,median_ms,p99_ms,min_ms,mean_ms,ghosts,mean_area" << endl;
+	else cout << "[" << endl;
+	bool firstResult = true;
+	for ( unsigned int strategyIndex = 0; strategyIndex < strategies.size(); strategyIndex++ )
+	{
+		BenchmarkStrategy & strategy = *strategies[ strategyIndex ];
+		for ( unsigned int eventIndex = 0; eventIndex < events.size(); eventIndex++ )
+		{
+			BenchmarkEvent const& event = events[ eventIndex ];
+			cerr << strategy.Name() << " on " << event.name << " with " << event.particles.size() << " particles" << endl;
+
+			vector< ReferenceJet > jets;
+			vector< double > times;
+			bool ran = true;
+			for ( unsigned int run = 0; ran && run < warmUps + repetitions; run++ )
+			{
+				double seconds;
+				ran = strategy.Run( event.particles, event.fileName, jets, seconds );
+				if ( run >= warmUps ) times.push_back( seconds );
+			}
+			if ( !ran )
+			{
+				cerr << strategy.Name() << " failed, skipping it" << endl;
+				break;
+			}
+
+			vector< ReferenceJet > reference = event.reference;
+			while ( !reference.empty() && reference.back().pt < strategy.PtCut() ) reference.pop_back();
+			unsigned int const differences = CompareJetTables( jets, reference, stderr );
+
+			sort( times.begin(), times.end() );
+			double mean = 0.0;
+			for ( unsigned int run = 0; run < times.size(); run++ ) mean += times[ run ] / times.size();
+			double const median = Percentile( times, 0.5 );
+			double meanArea = 0.0;
+			for ( unsigned int jetIndex = 0; jetIndex < jets.size(); jetIndex++ ) meanArea += jets[ jetIndex ].area / jets.size();
+			if ( format == "csv" )
+			{
+				printf( "%s,%s,%u,%lu,%u,%s,%u,%u,%.6f,%.6f,%.6f,%.6f,%u,%.6f\n", strategy.Name().c_str(), event.name.c_str(), event.particles.size(), jets.size(),
+						differences, event.referenceName.c_str(), warmUps, repetitions,
+						median * 1000.0, Percentile( times, 0.99 ) * 1000.0, times.front() * 1000.0, mean * 1000.0, strategy.Ghosts(), meanArea );
+			}
+			else
+			{
+				//Jet areas in pT order when there are any
+				printf( "%s  {\"strategy\": \"%s\", \"event\": \"%s\", \"particles\": %u, \"jets\": %lu, \"differences\": %u, \"reference\": \"%s\", "
+						"\"warmups\": %u, \"runs\": %u, \"median_ms\": %.6f, \"p99_ms\": %.6f, \"min_ms\": %.6f, \"mean_ms\": %.6f, \"ghosts\": %u, \"mean_area\": %.6f",
+						firstResult ? "" : ",\n", strategy.Name().c_str(), event.name.c_str(), event.particles.size(), jets.size(),
+						differences, event.referenceName.c_str(), warmUps, repetitions,
+						median * 1000.0, Percentile( times, 0.99 ) * 1000.0, times.front() * 1000.0, mean * 1000.0, strategy.Ghosts(), meanArea );
+				if ( strategy.Ghosts() )
+				{
+					printf( ", \"areas\": [" );
+					for ( unsigned int jetIndex = 0; jetIndex < jets.size(); jetIndex++ ) printf( "%s%.6f", jetIndex ? ", " : "", jets[ jetIndex ].area );
+					printf( "]" );
+				}
+				printf( "}" );
+			}
+			firstResult = false;
+			fflush( stdout );
+
+			if ( median > budget )
+			{
+				cerr << strategy.Name() << " is over budget, skipping bigger events" << endl;
+				break;
+			}
+		}
+	}
+	if ( format == "json" ) cout << endl << "]" << endl;
+
+	for ( unsigned int i = 0; i < events.size(); i++ ) unlink( events[ i ].fileName.c_str() );
+	return 0;
+}
@@ -0,0 +1,63 @@
+#include <string>
+#include <iostream>
+
+#include "ParticleArrays.h"
+#include "MappedEventReader.h"
+#include "BinaryEventFile.h"
+
+using namespace std;
+
+//Convert text events (fastjet example format, #END between events) to a binary event file
+int main( int argc, char * argv[] )
+{
+	bool withKinematics = false;
+	string kinematicsName = "auto";
+	int argIndex = 1;
+	while ( argIndex < argc )
+	{
+		string const arg = argv[ argIndex ];
+		if ( arg == "-k" ) withKinematics = true;
+		else if ( arg == "-K" && argIndex + 1 < argc ) kinematicsName = argv[ ++argIndex ];
+		else break;
+		argIndex++;
+	}
+	KinematicsKernel const kinematics = SelectKinematicsKernel( kinematicsName );
+	if ( argc - argIndex != 2 || !kinematics )
+	{
+		cerr << "Usage: " << argv[ 0 ] << " [-k [-K auto|exact|scalar|avx2|avx512]] input.dat output.bin" << endl;
+		cerr << "  -k also stores pT^2, rapidity and phi of every particle, worked out with the -K kinematics (default auto)" << endl;
+		cerr << "  benJet only uses them with -K of the same kind: exact, or any of the approximations" << endl;
+		return 1;
+	}
+
+	MappedEventReader input( argv[ argIndex ] );
+	if ( !input.IsOpen() )
+	{
+		cerr << "Can't read " << argv[ argIndex ] << endl;
+		return 1;
+	}
+	BinaryEventWriter output( argv[ argIndex + 1 ], withKinematics, kinematics );
+	if ( !output.IsOpen() )
+	{
+		cerr << "Can't write " << argv[ argIndex + 1 ] << endl;
+		return 1;
+	}
+
+	ParticleArrays particles;
+	unsigned long events = 0;
+	unsigned long totalParticles = 0;
+	while ( input.ReadEvent( particles ) )
+	{
+		output.WriteEvent( particles );
+		events++;
+		totalParticles += particles.size();
+	}
+	if ( !output.Close() )
+	{
+		cerr << "Error writing " << argv[ argIndex + 1 ] << endl;
+		return 1;
+	}
+
+	cout << "Converted " << events << " events, " << totalParticles << " particles" << endl;
+	return 0;
+}
@@ -0,0 +1,252 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <random>
+#include <iostream>
+
+#include "ParticleArrays.h"
+#include "MappedEventReader.h"
+#include "BinaryEventFile.h"
+
+using namespace std;
+
+//Where the particles of a generated event go: straight out to a text file as they are made,
+//or into one event's worth of arrays for the binary writer, which stores each event sorted by pT
+class PileupOutput
+{
+	public:
+		PileupOutput( string const& FileName, bool Binary, bool WithKinematics ) : m_text( 0 ), m_binary( 0 )
+		{
+			if ( Binary )
+			{
+				m_binary = new BinaryEventWriter( FileName, WithKinematics );
+				if ( !m_binary->IsOpen() )
+				{
+					delete m_binary;
+					m_binary = 0;
+				}
+				return;
+			}
+			m_text = ( FileName == "-" ) ? stdout : fopen( FileName.c_str(), "w" );
+			if ( m_text ) setvbuf( m_text, 0, _IOFBF, 1 << 20 );
+		}
+		~PileupOutput()
+		{
+			this->Close();
+		}
+
+		bool IsOpen() const
+		{
+			return m_text || m_binary;
+		}
+
+		void Add( double Px, double Py, double Pz, double E )
+		{
+			//Full precision, so the text and binary files hold the same event
+			if ( m_text ) fprintf( m_text, "%.17g %.17g %.17g %.17g\n", Px, Py, Pz, E );
+			else m_event.push_back( Px, Py, Pz, E );
+		}
+
+		void EndEvent()
+		{
+			if ( m_text ) fputs( "#END\n", m_text );
+			else
+			{
+				m_binary->WriteEvent( m_event );
+				m_event.clear();
+			}
+		}
+
+		//False if anything failed to write
+		bool Close()
+		{
+			bool good = true;
+			if ( m_text )
+			{
+				good = !ferror( m_text );
+				if ( m_text == stdout ) good = ( fflush( m_text ) == 0 ) && good;
+				else good = ( fclose( m_text ) == 0 ) && good;
+				m_text = 0;
+			}
+			if ( m_binary )
+			{
+				good = m_binary->Close();
+				delete m_binary;
+				m_binary = 0;
+			}
+			return good;
+		}
+
+	private:
+		FILE * m_text;
+		BinaryEventWriter * m_binary;
+		ParticleArrays m_event;
+};
+
+//Every event in a text file
+bool ReadAllEvents( string const& FileName, vector< ParticleArrays > & Events )
+{
+	Events.clear();
+	MappedEventReader input( FileName );
+	if ( !input.IsOpen() ) return false;
+	ParticleArrays particles;
+	while ( input.ReadEvent( particles ) )
+	{
+		if ( particles.size() ) Events.push_back( particles );
+	}
+	return !Events.empty();
+}
+
+void PrintUsage( char const * Name )
+{
+	cerr << "Usage: " << Name << " [-H hard.dat|none] -m minbias.dat [-u mu] [-F] [-n events] [-y rapidity shift] [-S seed] [-b] [-k] output" << endl;
+	cerr << "  Overlays K copies of minimum bias events on the hard event, each rotated in phi and shifted in rapidity" << endl;
+	cerr << "  -H hard event, the first in the file (default single-event.dat), or none for pileup only" << endl;
+	cerr << "  -m minimum bias events, one interaction each; each copy is one of them picked at random" << endl;
+	cerr << "  -u mean number of copies, 0 to 1000 (default 50); K is Poisson distributed, or exactly mu with -F" << endl;
+	cerr << "  mu counts interactions only if each -m event is one. The pileup event here is a single event of" << endl;
+	cerr << "  all the interactions of a crossing, with its own hard Z: with it every copy is that whole event" << endl;
+	cerr << "  -y each copy is shifted in rapidity by up to this much either way (default 0.5)" << endl;
+	cerr << "  -b writes a binary event file, -k with kinematics; otherwise text, - for standard output" << endl;
+	cerr << "  -h or --help shows this" << endl;
+}
+
+int main( int argc, char * argv[] )
+{
+	string hardName = "single-event.dat";
+	string minBiasName;
+	double mu = 50.0;
+	bool fixedCopies = false;
+	unsigned long totalEvents = 1;
+	double maxShift = 0.5;
+	unsigned long seed = 1;
+	bool binary = false;
+	bool withKinematics = false;
+	string outputName;
+	for ( int argIndex = 1; argIndex < argc; argIndex++ )
+	{
+		string const arg = argv[ argIndex ];
+		if ( arg == "-h" || arg == "--help" )
+		{
+			PrintUsage( argv[ 0 ] );
+			return 0;
+		}
+		if ( arg == "-F" ) fixedCopies = true;
+		else if ( arg == "-b" ) binary = true;
+		else if ( arg == "-k" ) withKinematics = true;
+		else if ( arg == "-" || ( !arg.empty() && arg[ 0 ] != '-' ) )
+		{
+			//The one output, so an option can never be taken for it
+			if ( !outputName.empty() )
+			{
+				PrintUsage( argv[ 0 ] );
+				return 1;
+			}
+			outputName = arg;
+		}
+		else if ( argIndex + 1 >= argc )
+		{
+			PrintUsage( argv[ 0 ] );
+			return 1;
+		}
+		else
+		{
+			string const value = argv[ ++argIndex ];
+			if ( arg == "-H" ) hardName = value;
+			else if ( arg == "-m" ) minBiasName = value;
+			else if ( arg == "-u" ) mu = atof( value.c_str() );
+			else if ( arg == "-n" ) totalEvents = strtoul( value.c_str(), 0, 10 );
+			else if ( arg == "-y" ) maxShift = fabs( atof( value.c_str() ) );
+			else if ( arg == "-S" ) seed = strtoul( value.c_str(), 0, 10 );
+			else
+			{
+				PrintUsage( argv[ 0 ] );
+				return 1;
+			}
+		}
+	}
+	if ( outputName.empty() || minBiasName.empty() || !( mu >= 0.0 && mu <= 1000.0 ) || ( withKinematics && !binary ) )
+	{
+		PrintUsage( argv[ 0 ] );
+		return 1;
+	}
+
+	ParticleArrays hard;
+	if ( hardName != "none" )
+	{
+		MappedEventReader input( hardName );
+		if ( !input.IsOpen() || !input.ReadEvent( hard ) )
+		{
+			cerr << "Can't read " << hardName << endl;
+			return 1;
+		}
+	}
+	vector< ParticleArrays > minBias;
+	if ( !ReadAllEvents( minBiasName, minBias ) )
+	{
+		cerr << "Can't read " << minBiasName << endl;
+		return 1;
+	}
+	if ( minBias.size() == 1 )
+	{
+		cerr << minBiasName << " holds one event, so every copy is that same event and mu counts copies of it" << endl;
+	}
+
+	PileupOutput output( outputName, binary, withKinematics );
+	if ( !output.IsOpen() )
+	{
+		cerr << "Can't write " << outputName << endl;
+		return 1;
+	}
+
+	//Everything comes from one generator, so the same seed and options give the same events
+	mt19937_64 generator( seed );
+	poisson_distribution< unsigned int > copyCount( mu > 0.0 ? mu : 1.0 );
+	uniform_int_distribution< unsigned int > pickEvent( 0, minBias.size() - 1 );
+	uniform_real_distribution< double > pickAngle( -M_PI, M_PI );
+	uniform_real_distribution< double > pickShift( -maxShift, maxShift );
+
+	unsigned long totalParticles = 0;
+	unsigned long totalCopies = 0;
+	for ( unsigned long event = 0; event < totalEvents; event++ )
+	{
+		for ( unsigned int i = 0; i < hard.size(); i++ ) output.Add( hard.px[ i ], hard.py[ i ], hard.pz[ i ], hard.E[ i ] );
+		totalParticles += hard.size();
+
+		unsigned int const copies = ( mu == 0.0 ) ? 0 : fixedCopies ? ( unsigned int )lround( mu ) : copyCount( generator );
+		for ( unsigned int copy = 0; copy < copies; copy++ )
+		{
+			ParticleArrays const& source = minBias[ pickEvent( generator ) ];
+			double const angle = pickAngle( generator );
+			double const shift = pickShift( generator );
+			double const cosine = cos( angle );
+			double const sine = sin( angle );
+
+			//Boost along the beam: E + pz and E - pz scale by exp( +-shift ), so every rapidity moves
+			//by shift and pT and the mass stay the same
+			double const forward = 0.5 * exp( shift );
+			double const backward = 0.5 * exp( -shift );
+			for ( unsigned int i = 0; i < source.size(); i++ )
+			{
+				double const plus = ( source.E[ i ] + source.pz[ i ] ) * forward;
+				double const minus = ( source.E[ i ] - source.pz[ i ] ) * backward;
+				output.Add( ( source.px[ i ] * cosine ) - ( source.py[ i ] * sine ),
+						( source.px[ i ] * sine ) + ( source.py[ i ] * cosine ),
+						plus - minus, plus + minus );
+			}
+			totalParticles += source.size();
+		}
+		totalCopies += copies;
+		output.EndEvent();
+	}
+	if ( !output.Close() )
+	{
+		cerr << "Error writing " << outputName << endl;
+		return 1;
+	}
+
+	cerr << "Wrote " << totalEvents << " events, " << totalCopies << " minimum bias copies, " << totalParticles << " particles" << endl;
+	return 0;
+}
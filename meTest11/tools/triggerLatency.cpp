@@ -0,0 +1,188 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <random>
+
+#include "tbb/tick_count.h"
+
+#include "FourMomentum.h"
+#include "ParticleArrays.h"
+#include "MappedEventReader.h"
+#include "ClusterDispatch.h"
+#include "TriggerClusterer.h"
+
+using namespace std;
+
+//Latency of the trigger clusterer, anti-kt R = 0.6 with room for 512 inputs, one event at a time.
+//Events of each size are drawn at random from the pileup event, in no particular order as a trigger
+//would get them, and each is timed on its own after some warm-up events. The histogram of the times
+//goes to stdout as CSV, with a summary of each size on stderr: percentiles, events over the budget,
+//and the most delta_R^2 evaluations any event took against the documented worst case.
+//Every event is also clustered by Test11 on the same inputs, and the jets have to be identical.
+
+typedef TriggerClusterer< AntiKt, FixedRadius< 3, 5 >, 512 > Trigger;
+
+//Static, since it's too big for the stack and new doesn't align it before C++17
+static Trigger trigger;
+
+//Count particles drawn from Source without replacement
+void DrawEvent( ParticleArrays const& Source, unsigned int Count, mt19937 & Generator, vector< unsigned int > & Order, ParticleArrays & Event )
+{
+	unsigned int const total = Source.size();
+	Order.resize( total );
+	for ( unsigned int i = 0; i < total; i++ ) Order[ i ] = i;
+	Event.clear();
+	for ( unsigned int i = 0; i < Count; i++ )
+	{
+		swap( Order[ i ], Order[ i + ( Generator() % ( total - i ) ) ] );
+		Event.push_back( Source.px[ Order[ i ] ], Source.py[ Order[ i ] ], Source.pz[ Order[ i ] ], Source.E[ Order[ i ] ] );
+	}
+}
+
+//Whether the trigger's jets are exactly the ones Test11 made
+bool SameJets( vector< FourMomentum > const& Expected )
+{
+	if ( trigger.JetCount() != Expected.size() ) return false;
+	for ( unsigned int jetIndex = 0; jetIndex < Expected.size(); jetIndex++ )
+	{
+		FourMomentum const& jet = trigger.Jets()[ jetIndex ];
+		if ( jet.Px() != Expected[ jetIndex ].Px() || jet.Py() != Expected[ jetIndex ].Py() || jet.Pz() != Expected[ jetIndex ].Pz() || jet.E() != Expected[ jetIndex ].E() ) return false;
+	}
+	return true;
+}
+
+//Value of a sorted list below which Fraction of the entries lie
+double Percentile( vector< double > const& Sorted, double Fraction )
+{
+	if ( Sorted.empty() ) return 0.0;
+	unsigned int index = ( unsigned int )( Fraction * Sorted.size() );
+	if ( index >= Sorted.size() ) index = Sorted.size() - 1;
+	return Sorted[ index ];
+}
+
+//Comma separated list
+vector< string > SplitList( string const& List )
+{
+	vector< string > items;
+	istringstream input( List );
+	string item;
+	while ( getline( input, item, ',' ) ) if ( !item.empty() ) items.push_back( item );
+	return items;
+}
+
+void PrintUsage( char const * Name )
+{
+	cerr << "Usage: " << Name << " [-i pileup.dat] [-n particles,...] [-e events] [-w warm-up events] [-B budget us] [-H bin width us] [-S seed]" << endl;
+	cerr << "  -n sizes to draw from the pileup event, at most " << Trigger::Capacity << ", default 64,128,256,512" << endl;
+	cerr << "  -e events of each size, default 10000, after -w warm-up events, default 100" << endl;
+	cerr << "  -B counts the events slower than this many microseconds (default 50), -H sets the histogram bins (default 1)" << endl;
+}
+
+int main( int argc, char * argv[] )
+{
+	string pileupName = "Pythia-Z2jets-lhc-pileup-1ev.allSmushedTogether.dat";
+	string sizeList = "64,128,256,512";
+	unsigned int events = 10000;
+	unsigned int warmUps = 100;
+	double budget = 50.0;
+	double binWidth = 1.0;
+	unsigned int seed = 1;
+	for ( int argIndex = 1; argIndex < argc; argIndex++ )
+	{
+		string const arg = argv[ argIndex ];
+		if ( argIndex + 1 >= argc )
+		{
+			PrintUsage( argv[ 0 ] );
+			return 1;
+		}
+		string const value = argv[ ++argIndex ];
+		if ( arg == "-i" ) pileupName = value;
+		else if ( arg == "-n" ) sizeList = value;
+		else if ( arg == "-e" && atoi( value.c_str() ) > 0 ) events = atoi( value.c_str() );
+		else if ( arg == "-w" ) warmUps = atoi( value.c_str() );
+		else if ( arg == "-B" && atof( value.c_str() ) > 0.0 ) budget = atof( value.c_str() );
+		else if ( arg == "-H" && atof( value.c_str() ) > 0.0 ) binWidth = atof( value.c_str() );
+		else if ( arg == "-S" ) seed = atoi( value.c_str() );
+		else
+		{
+			PrintUsage( argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	ParticleArrays pileup;
+	MappedEventReader input( pileupName );
+	if ( !input.IsOpen() || !input.ReadEvent( pileup ) || !pileup.size() )
+	{
+		cerr << "Can't read " << pileupName << endl;
+		return 1;
+	}
+	vector< unsigned int > sizes;
+	vector< string > const sizeNames = SplitList( sizeList );
+	for ( unsigned int i = 0; i < sizeNames.size(); i++ )
+	{
+		unsigned int const size = strtoul( sizeNames[ i ].c_str(), 0, 10 );
+		if ( size > Trigger::Capacity || size > pileup.size() )
+		{
+			cerr << "Can't draw " << size << " particles, the trigger takes at most " << Trigger::Capacity << " and the pileup event has " << pileup.size() << endl;
+			return 1;
+		}
+		sizes.push_back( size );
+	}
+
+	mt19937 generator( seed );
+	vector< unsigned int > order;
+	ParticleArrays event;
+	ClusterOptions const options;
+	ClusterWorkspace workspace;
+	vector< FourMomentum > expected;
+	cout << "particles,bin_low_us,bin_high_us,events,cumulative_fraction" << endl;
+	for ( unsigned int sizeIndex = 0; sizeIndex < sizes.size(); sizeIndex++ )
+	{
+		unsigned int const size = sizes[ sizeIndex ];
+		vector< double > times;
+		times.reserve( events );
+		unsigned long maxPairs = 0;
+		unsigned int mismatches = 0;
+		for ( unsigned int eventIndex = 0; eventIndex < warmUps + events; eventIndex++ )
+		{
+			DrawEvent( pileup, size, generator, order, event );
+
+			tbb::tick_count const start = tbb::tick_count::now();
+			trigger.Cluster( event );
+			double const microseconds = ( tbb::tick_count::now() - start ).seconds() * 1e6;
+			if ( eventIndex < warmUps ) continue;
+			times.push_back( microseconds );
+			maxPairs = max( maxPairs, trigger.PairsEvaluated() );
+
+			ClusterTiming timing;
+			expected.clear();
+			ClusterJets( JetDefinition(), options, workspace, event, expected, timing );
+			if ( !SameJets( expected ) ) mismatches++;
+		}
+
+		//Times are sorted, so each bin is the run of them below its upper edge
+		sort( times.begin(), times.end() );
+		unsigned int counted = 0;
+		for ( unsigned int bin = 0; counted < times.size(); bin++ )
+		{
+			double const binLow = bin * binWidth;
+			unsigned int const first = counted;
+			while ( counted < times.size() && times[ counted ] < binLow + binWidth ) counted++;
+			if ( counted == first ) continue;
+			printf( "%u,%.3f,%.3f,%u,%.6f\n", size, binLow, binLow + binWidth, counted - first, double( counted ) / times.size() );
+		}
+		fflush( stdout );
+
+		unsigned int const overBudget = times.end() - upper_bound( times.begin(), times.end(), budget );
+		fprintf( stderr, "%u particles: median %.2f us, p99 %.2f us, p99.9 %.2f us, max %.2f us, %u of %u over %.1f us, %u mismatches,"
+				" at most %lu delta_R^2 against a worst case of %lu\n", size, Percentile( times, 0.5 ), Percentile( times, 0.99 ), Percentile( times, 0.999 ),
+				times.back(), overBudget, events, budget, mismatches, maxPairs, Trigger::WorstCasePairs( size ) );
+	}
+	return 0;
+}
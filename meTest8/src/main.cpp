@@ -0,0 +1,366 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <map>
+
+#include "tbb/tick_count.h"
+
+#include "TLorentzVector.h"
+
+using namespace std;
+using namespace tbb;
+
+bool SortJetsByPt( TLorentzVector const& i, TLorentzVector const& j )
+{
+	return ( i.Pt() > j.Pt() );
+}
+
+//Try to make some jets myself
+int main( int argc, char * argv[] )
+{
+	vector< TLorentzVector > inputs, outputs;
+
+	//Dummy TLV for conversions
+	TLorentzVector dummy1;
+
+	//Read the fastjet example input into TLVs
+	double px, py, pz, E;
+	while ( cin >> px >> py >> pz >> E )
+	{
+		inputs.push_back( TLorentzVector( px, py, pz, E ) );
+	}
+
+	//Sorting the input pT high to low gives a large speedup
+	sort( inputs.begin(), inputs.end(), SortJetsByPt );
+
+	//kt^2n = pt^2n //for single objects
+	//kt^2n = min( pt^2n ) x delta_R^2 / D^2 //for pairs
+	//Just do akt 0.6
+	double const D = 0.6;
+	double const aD2 = 1.0 / ( D * D );
+	double const TWO_PI = 2.0 * M_PI;
+
+	//Copy input data into flat arrays
+	unsigned int const totalObjects = inputs.size();
+	double phis[ totalObjects ];
+	double rapidities[ totalObjects ];
+	double pts[ totalObjects ];
+	double apt2s[ totalObjects ];
+	double energies[ totalObjects ];
+	double pxs[ totalObjects ];
+	double pys[ totalObjects ];
+	double pzs[ totalObjects ];
+	double cachedMinKts[ totalObjects ];
+	unsigned int cachedMinKtPairs[ totalObjects ];
+	bool wasDeleted[ totalObjects ];
+	double minRapidity = DBL_MAX;
+	double maxRapidity = -DBL_MAX;
+	for ( unsigned int i = 0; i < totalObjects; i++ )
+	{
+		TLorentzVector const& dummy = inputs[ i ];
+		phis[ i ] = dummy.Phi();
+		rapidities[ i ] =  dummy.Rapidity();
+		pts[ i ] = dummy.Pt();
+		apt2s[ i ] = 1.0 / ( pts[ i ] * pts[ i ] );
+		pxs[ i ] = dummy.Px();
+		pys[ i ] = dummy.Py();
+		pzs[ i ] = dummy.Pz();
+		energies[ i ] = dummy.E();
+		cachedMinKts[ i ] = DBL_MAX;
+		cachedMinKtPairs[ i ] = i;
+		wasDeleted[ i ] = false;
+		if ( rapidities[ i ] < minRapidity ) minRapidity = rapidities[ i ];
+		if ( rapidities[ i ] > maxRapidity ) maxRapidity = rapidities[ i ];
+	}
+	if ( !totalObjects ) minRapidity = maxRapidity = 0.0;
+
+	//Tiles are at least D wide in both directions, so any pair with delta_R < D
+	//sits in the same or an adjacent tile. Phi tiles wrap around.
+	unsigned int const phiTiles = max( 1, int( floor( TWO_PI / D ) ) );
+	double const phiTileWidth = TWO_PI / double( phiTiles );
+	unsigned int const rapidityTiles = max( 1, int( floor( ( maxRapidity - minRapidity ) / D ) ) );
+	double const rapidityTileWidth = max( D, ( maxRapidity - minRapidity ) / double( rapidityTiles ) );
+	unsigned int const totalTiles = phiTiles * rapidityTiles;
+
+	//Each tile owns an intrusive doubly-linked list of the objects inside it
+	int tileHeads[ totalTiles ];
+	unsigned int tileNeighbours[ totalTiles * 9 ];
+	unsigned int tileNeighbourCounts[ totalTiles ];
+	unsigned int tileStamps[ totalTiles ];
+	for ( unsigned int tileIndex = 0; tileIndex < totalTiles; tileIndex++ )
+	{
+		tileHeads[ tileIndex ] = -1;
+		tileStamps[ tileIndex ] = 0;
+		tileNeighbourCounts[ tileIndex ] = 0;
+
+		//List the 3x3 block around each tile once, without duplicates when there are few tiles
+		int const rapidityTile = tileIndex / phiTiles;
+		int const phiTile = tileIndex % phiTiles;
+		for ( int rapidityStep = -1; rapidityStep <= 1; rapidityStep++ )
+		{
+			int const neighbourRapidityTile = rapidityTile + rapidityStep;
+			if ( neighbourRapidityTile < 0 || neighbourRapidityTile >= int( rapidityTiles ) ) continue;
+			for ( int phiStep = -1; phiStep <= 1; phiStep++ )
+			{
+				int const neighbourPhiTile = ( phiTile + phiStep + int( phiTiles ) ) % int( phiTiles );
+				unsigned int const neighbour = neighbourRapidityTile * phiTiles + neighbourPhiTile;
+				unsigned int * const neighbours = &tileNeighbours[ tileIndex * 9 ];
+				if ( find( neighbours, neighbours + tileNeighbourCounts[ tileIndex ], neighbour ) == neighbours + tileNeighbourCounts[ tileIndex ] )
+				{
+					neighbours[ tileNeighbourCounts[ tileIndex ]++ ] = neighbour;
+				}
+			}
+		}
+	}
+	int nextInTile[ totalObjects ];
+	int previousInTile[ totalObjects ];
+	unsigned int tileOfObject[ totalObjects ];
+
+	//Work out which tile an object belongs in
+	auto findTile = [&]( unsigned int objectIndex ) -> unsigned int
+	{
+		int rapidityTile = int( floor( ( rapidities[ objectIndex ] - minRapidity ) / rapidityTileWidth ) );
+		if ( rapidityTile < 0 ) rapidityTile = 0;
+		if ( rapidityTile >= int( rapidityTiles ) ) rapidityTile = rapidityTiles - 1;
+		int phiTile = int( floor( ( phis[ objectIndex ] + M_PI ) / phiTileWidth ) );
+		if ( phiTile < 0 ) phiTile = 0;
+		if ( phiTile >= int( phiTiles ) ) phiTile = phiTiles - 1;
+		return rapidityTile * phiTiles + phiTile;
+	};
+
+	//Tile membership updates
+	auto addToTile = [&]( unsigned int objectIndex )
+	{
+		unsigned int const tileIndex = findTile( objectIndex );
+		tileOfObject[ objectIndex ] = tileIndex;
+		previousInTile[ objectIndex ] = -1;
+		nextInTile[ objectIndex ] = tileHeads[ tileIndex ];
+		if ( tileHeads[ tileIndex ] >= 0 ) previousInTile[ tileHeads[ tileIndex ] ] = objectIndex;
+		tileHeads[ tileIndex ] = objectIndex;
+	};
+	auto removeFromTile = [&]( unsigned int objectIndex )
+	{
+		if ( previousInTile[ objectIndex ] >= 0 ) nextInTile[ previousInTile[ objectIndex ] ] = nextInTile[ objectIndex ];
+		else tileHeads[ tileOfObject[ objectIndex ] ] = nextInTile[ objectIndex ];
+		if ( nextInTile[ objectIndex ] >= 0 ) previousInTile[ nextInTile[ objectIndex ] ] = previousInTile[ objectIndex ];
+	};
+
+	//Pair kt^2 for two objects, only if they are close enough to be in each other's tiles
+	auto pairKt2 = [&]( unsigned int thisObjectIndex, unsigned int pairObjectIndex ) -> double
+	{
+		double deltaPhi = phis[ thisObjectIndex ] - phis[ pairObjectIndex ];
+		if ( deltaPhi > M_PI ) deltaPhi -= TWO_PI;
+		if ( deltaPhi < -M_PI ) deltaPhi += TWO_PI;
+		double const deltaRapidity = rapidities[ thisObjectIndex ] - rapidities[ pairObjectIndex ];
+		double const kt2 = ( ( deltaPhi * deltaPhi ) + ( deltaRapidity * deltaRapidity ) ) * aD2;
+		if ( kt2 >= 1.0 ) return DBL_MAX;
+		return kt2 * min( apt2s[ thisObjectIndex ], apt2s[ pairObjectIndex ] );
+	};
+
+	//Find the best partner for an object, looking only in the surrounding tiles
+	auto refreshCache = [&]( unsigned int thisObjectIndex )
+	{
+		//Self values
+		double const thisApt2 = apt2s[ thisObjectIndex ];
+		double const thisPhi = phis[ thisObjectIndex ];
+		double const thisRapidity = rapidities[ thisObjectIndex ];
+		double minKt2 = thisApt2;
+		unsigned int minKt2Pair = thisObjectIndex;
+
+		unsigned int const thisTile = tileOfObject[ thisObjectIndex ];
+		unsigned int const * const neighbours = &tileNeighbours[ thisTile * 9 ];
+		for ( unsigned int neighbourIndex = 0; neighbourIndex < tileNeighbourCounts[ thisTile ]; neighbourIndex++ )
+		{
+			for ( int pairObjectIndex = tileHeads[ neighbours[ neighbourIndex ] ]; pairObjectIndex >= 0; pairObjectIndex = nextInTile[ pairObjectIndex ] )
+			{
+				if ( pairObjectIndex == int( thisObjectIndex ) ) continue;
+
+				//Pair values
+				double const pairApt2 = apt2s[ pairObjectIndex ];
+				double deltaPhi = thisPhi - phis[ pairObjectIndex ];
+				if ( deltaPhi > M_PI ) deltaPhi -= TWO_PI;
+				if ( deltaPhi < -M_PI ) deltaPhi += TWO_PI;
+				double const deltaRapidity = thisRapidity - rapidities[ pairObjectIndex ];
+				double kt2 = ( ( deltaPhi * deltaPhi ) + ( deltaRapidity * deltaRapidity ) ) * aD2;
+				if ( pairApt2 < thisApt2 )
+				{
+					kt2 *= pairApt2;
+				}
+				else
+				{
+					kt2 *= thisApt2;
+				}
+
+				//Find minimum, lowest index wins a tie so the tile order doesn't matter
+				if ( kt2 < minKt2 || ( kt2 == minKt2 && (unsigned int)pairObjectIndex < minKt2Pair ) )
+				{
+					minKt2 = kt2;
+					minKt2Pair = pairObjectIndex;
+				}
+			}
+		}
+
+		//Store minimum kt^2
+		cachedMinKts[ thisObjectIndex ] = minKt2;
+		cachedMinKtPairs[ thisObjectIndex ] = minKt2Pair;
+	};
+
+	//Make the jets
+	tick_count const startTime = tick_count::now();
+	tick_count::interval_t findMinKtTime;
+	tick_count::interval_t updateCollectionsTime;
+	tick_count::interval_t tileTime;
+
+	//Fill the tiles and the cache
+	tick_count const startTileTime = tick_count::now();
+	for ( unsigned int i = 0; i < totalObjects; i++ ) addToTile( i );
+	for ( unsigned int i = 0; i < totalObjects; i++ ) refreshCache( i );
+	tileTime += tick_count::now() - startTileTime;
+
+	unsigned int activeObjects = totalObjects;
+	unsigned int firstActive = 0;
+	unsigned int lastActive = totalObjects;
+	unsigned int stamp = 0;
+	while( activeObjects )
+	{
+		//Find min kt^2 value over all objects
+		tick_count const startKtTime = tick_count::now();
+		unsigned int thisMinIndex = firstActive;
+		double overallMinKt2 = cachedMinKts[ firstActive ];
+		for ( unsigned int thisObjectIndex = firstActive + 1; thisObjectIndex < lastActive; thisObjectIndex++ )
+		{
+			double cachedKt2 = cachedMinKts[ thisObjectIndex ];
+			if ( cachedKt2 < overallMinKt2 )
+			{
+				overallMinKt2 = cachedKt2;
+				thisMinIndex = thisObjectIndex;
+			}
+		}
+		unsigned int const pairMinIndex = cachedMinKtPairs[ thisMinIndex ];
+		findMinKtTime += tick_count::now() - startKtTime;
+
+		//Single objects as min kt are outputs, pairs get merged
+		tick_count const startUpdateTime = tick_count::now();
+
+		//Mark the tiles whose objects might need their cache changing
+		stamp++;
+		unsigned int touchedTiles[ 27 ];
+		unsigned int touchedTileCount = 0;
+		auto touchTilesAround = [&]( unsigned int tileIndex )
+		{
+			unsigned int const * const neighbours = &tileNeighbours[ tileIndex * 9 ];
+			for ( unsigned int neighbourIndex = 0; neighbourIndex < tileNeighbourCounts[ tileIndex ]; neighbourIndex++ )
+			{
+				unsigned int const neighbour = neighbours[ neighbourIndex ];
+				if ( tileStamps[ neighbour ] == stamp ) continue;
+				tileStamps[ neighbour ] = stamp;
+				touchedTiles[ touchedTileCount++ ] = neighbour;
+			}
+		};
+		touchTilesAround( tileOfObject[ thisMinIndex ] );
+		touchTilesAround( tileOfObject[ pairMinIndex ] );
+
+		bool const isMerge = ( thisMinIndex != pairMinIndex );
+		if ( !isMerge )
+		{
+			//Make output TLV
+			outputs.push_back( TLorentzVector( pxs[ thisMinIndex ], pys[ thisMinIndex ], pzs[ thisMinIndex ], energies[ thisMinIndex ] ) );
+
+			//Remove jet from active data
+			removeFromTile( thisMinIndex );
+			wasDeleted[ thisMinIndex ] = true;
+			cachedMinKts[ thisMinIndex ] = DBL_MAX;
+		}
+		else
+		{
+			//Merge the pair
+			double const newPx = pxs[ thisMinIndex ] + pxs[ pairMinIndex ];
+			double const newPy = pys[ thisMinIndex ] + pys[ pairMinIndex ];
+			double const newPz = pzs[ thisMinIndex ] + pzs[ pairMinIndex ];
+			double const newE = energies[ thisMinIndex ] + energies[ pairMinIndex ];
+
+			//Replace the original object with the merge
+			removeFromTile( thisMinIndex );
+			dummy1.SetPxPyPzE( newPx, newPy, newPz, newE ); //for convenience
+			pts[ thisMinIndex ] = dummy1.Pt();
+			apt2s[ thisMinIndex ] = 1.0 / ( pts[ thisMinIndex ] * pts[ thisMinIndex ] );
+			pxs[ thisMinIndex ] = newPx;
+			pys[ thisMinIndex ] = newPy;
+			pzs[ thisMinIndex ] = newPz;
+			rapidities[ thisMinIndex ] = dummy1.Rapidity();
+			phis[ thisMinIndex ] = dummy1.Phi();
+			energies[ thisMinIndex ] = newE;
+			addToTile( thisMinIndex );
+			touchTilesAround( tileOfObject[ thisMinIndex ] );
+
+			//Remove the pair object
+			removeFromTile( pairMinIndex );
+			wasDeleted[ pairMinIndex ] = true;
+			cachedMinKts[ pairMinIndex ] = DBL_MAX;
+
+			refreshCache( thisMinIndex );
+		}
+
+		//Objects pointing at a removed object need a full refresh, the rest only need to see if the merged object is closer.
+		//If the merged object got closer to something already pointing at it then nothing else can have overtaken it.
+		for ( unsigned int touchedIndex = 0; touchedIndex < touchedTileCount; touchedIndex++ )
+		{
+			for ( int objectIndex = tileHeads[ touchedTiles[ touchedIndex ] ]; objectIndex >= 0; objectIndex = nextInTile[ objectIndex ] )
+			{
+				if ( objectIndex == int( thisMinIndex ) ) continue;
+				unsigned int const cachedPair = cachedMinKtPairs[ objectIndex ];
+				if ( !isMerge || cachedPair == pairMinIndex )
+				{
+					if ( cachedPair == thisMinIndex || cachedPair == pairMinIndex ) refreshCache( objectIndex );
+					continue;
+				}
+
+				double const kt2 = pairKt2( objectIndex, thisMinIndex );
+				if ( cachedPair == thisMinIndex )
+				{
+					if ( kt2 <= cachedMinKts[ objectIndex ] ) cachedMinKts[ objectIndex ] = kt2;
+					else refreshCache( objectIndex );
+				}
+				else if ( kt2 < cachedMinKts[ objectIndex ] || ( kt2 == cachedMinKts[ objectIndex ] && thisMinIndex < cachedPair ) )
+				{
+					cachedMinKts[ objectIndex ] = kt2;
+					cachedMinKtPairs[ objectIndex ] = thisMinIndex;
+				}
+			}
+		}
+
+		//Reduce the search ranges
+		while ( firstActive < lastActive && wasDeleted[ firstActive ] ) firstActive++;
+		while ( lastActive > firstActive && wasDeleted[ lastActive - 1 ] ) lastActive--;
+
+		activeObjects--;
+		updateCollectionsTime += tick_count::now() - startUpdateTime;
+	}
+	cout << "Total time: " << ( tick_count::now() - startTime ).seconds() << " sec" << endl;
+	cout << "Tiling time: " << tileTime.seconds() << " sec" << endl;
+	cout << "Kt finding time: " << findMinKtTime.seconds() << " sec" << endl;
+	cout << "Collection update time: " << updateCollectionsTime.seconds() << " sec" << endl;
+
+	sort( outputs.begin(), outputs.end(), SortJetsByPt );
+
+	//Output exactly like fastjet demo
+	printf("%5s %15s %15s %15s\n","jet #", "rapidity", "phi", "pt");
+	for ( unsigned int jetIndex = 0; jetIndex < outputs.size(); jetIndex++ )
+	{
+		//if ( outputs[ jetIndex ].Pt() < 5.0 ) break;
+		double phi = outputs[ jetIndex ].Phi();
+		while ( phi < 0.0 ) phi += TWO_PI;
+		printf( "%5u %15.8f %15.8f %15.8f\n",
+				jetIndex,
+				outputs[ jetIndex ].Rapidity(),
+				phi,
+				outputs[ jetIndex ].Pt() );
+	}
+
+	return 0;
+}
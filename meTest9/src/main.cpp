@@ -0,0 +1,293 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <map>
+
+#include "tbb/tick_count.h"
+
+#include "TLorentzVector.h"
+
+using namespace std;
+using namespace tbb;
+
+bool SortJetsByPt( TLorentzVector const& i, TLorentzVector const& j )
+{
+	return ( i.Pt() > j.Pt() );
+}
+
+//Try to make some jets myself
+int main( int argc, char * argv[] )
+{
+	vector< TLorentzVector > inputs, outputs;
+
+	//Dummy TLV for conversions
+	TLorentzVector dummy1;
+
+	//Read the fastjet example input into TLVs
+	double px, py, pz, E;
+	while ( cin >> px >> py >> pz >> E )
+	{
+		inputs.push_back( TLorentzVector( px, py, pz, E ) );
+	}
+
+	//Sorting the input pT high to low gives a large speedup
+	sort( inputs.begin(), inputs.end(), SortJetsByPt );
+
+	//Copy input data into flat arrays
+	unsigned int const totalObjects = inputs.size();
+	double phis[ totalObjects ];
+	double rapidities[ totalObjects ];
+	double pts[ totalObjects ];
+	double apt2s[ totalObjects ];
+	double energies[ totalObjects ];
+	double pxs[ totalObjects ];
+	double pys[ totalObjects ];
+	double pzs[ totalObjects ];
+	double nearestDeltaR2s[ totalObjects ];
+	unsigned int nearestNeighbours[ totalObjects ];
+	double cachedMinKts[ totalObjects ];
+	bool wasDeleted[ totalObjects ];
+	for ( unsigned int i = 0; i < totalObjects; i++ )
+	{
+		TLorentzVector const& dummy = inputs[ i ];
+		phis[ i ] = dummy.Phi();
+		rapidities[ i ] =  dummy.Rapidity();
+		pts[ i ] = dummy.Pt();
+		apt2s[ i ] = 1.0 / ( pts[ i ] * pts[ i ] );
+		pxs[ i ] = dummy.Px();
+		pys[ i ] = dummy.Py();
+		pzs[ i ] = dummy.Pz();
+		energies[ i ] = dummy.E();
+		nearestDeltaR2s[ i ] = DBL_MAX;
+		nearestNeighbours[ i ] = i;
+		cachedMinKts[ i ] = DBL_MAX;
+		wasDeleted[ i ] = false;
+	}
+
+	//kt^2n = pt^2n //for single objects
+	//kt^2n = min( pt^2n ) x delta_R^2 / D^2 //for pairs
+	//The smallest pair kt^2 is always between geometric nearest neighbours,
+	//so each object only needs to remember its nearest neighbour
+	//Just do akt 0.6
+	double const D = 0.6;
+	double const aD2 = 1.0 / ( D * D );
+	double const TWO_PI = 2.0 * M_PI;
+
+	unsigned int firstActive = 0;
+	unsigned int lastActive = totalObjects;
+
+	//Geometric distance between two objects
+	auto deltaR2 = [&]( unsigned int thisObjectIndex, unsigned int pairObjectIndex ) -> double
+	{
+		double deltaPhi = phis[ thisObjectIndex ] - phis[ pairObjectIndex ];
+		if ( deltaPhi > M_PI ) deltaPhi -= TWO_PI;
+		if ( deltaPhi < -M_PI ) deltaPhi += TWO_PI;
+		double const deltaRapidity = rapidities[ thisObjectIndex ] - rapidities[ pairObjectIndex ];
+		return ( deltaPhi * deltaPhi ) + ( deltaRapidity * deltaRapidity );
+	};
+
+	//The kt^2 an object would have with its nearest neighbour, or alone
+	auto updateKt2 = [&]( unsigned int thisObjectIndex )
+	{
+		unsigned int const neighbour = nearestNeighbours[ thisObjectIndex ];
+		double const thisApt2 = apt2s[ thisObjectIndex ];
+		if ( neighbour == thisObjectIndex )
+		{
+			cachedMinKts[ thisObjectIndex ] = thisApt2;
+			return;
+		}
+		double const kt2 = nearestDeltaR2s[ thisObjectIndex ] * aD2 * min( thisApt2, apt2s[ neighbour ] );
+		cachedMinKts[ thisObjectIndex ] = min( kt2, thisApt2 );
+	};
+
+	//Find the nearest neighbour of an object from all active objects
+	auto findNeighbour = [&]( unsigned int thisObjectIndex )
+	{
+		//Self values
+		double const thisPhi = phis[ thisObjectIndex ];
+		double const thisRapidity = rapidities[ thisObjectIndex ];
+		double minDeltaR2 = DBL_MAX;
+		unsigned int minDeltaR2Pair = thisObjectIndex;
+
+		//Create pairs
+		for ( unsigned int pairObjectIndex = firstActive; pairObjectIndex < lastActive; pairObjectIndex++ )
+		{
+			if ( wasDeleted[ pairObjectIndex ] || pairObjectIndex == thisObjectIndex ) continue;
+
+			//Pair values
+			double deltaPhi = thisPhi - phis[ pairObjectIndex ];
+			if ( deltaPhi > M_PI ) deltaPhi -= TWO_PI;
+			if ( deltaPhi < -M_PI ) deltaPhi += TWO_PI;
+			double const deltaRapidity = thisRapidity - rapidities[ pairObjectIndex ];
+			double const pairDeltaR2 = ( deltaPhi * deltaPhi ) + ( deltaRapidity * deltaRapidity );
+
+			//Find minimum
+			if ( pairDeltaR2 < minDeltaR2 )
+			{
+				minDeltaR2 = pairDeltaR2;
+				minDeltaR2Pair = pairObjectIndex;
+			}
+		}
+
+		//Store nearest neighbour
+		nearestDeltaR2s[ thisObjectIndex ] = minDeltaR2;
+		nearestNeighbours[ thisObjectIndex ] = minDeltaR2Pair;
+		updateKt2( thisObjectIndex );
+	};
+
+	//Make the jets
+	tick_count const startTime = tick_count::now();
+	tick_count::interval_t findMinKtTime;
+	tick_count::interval_t updateCollectionsTime;
+
+	//Initial neighbours: each pair is only measured once
+	tick_count const startKtTime = tick_count::now();
+	for ( unsigned int thisObjectIndex = 0; thisObjectIndex < totalObjects; thisObjectIndex++ )
+	{
+		for ( unsigned int pairObjectIndex = thisObjectIndex + 1; pairObjectIndex < totalObjects; pairObjectIndex++ )
+		{
+			double const pairDeltaR2 = deltaR2( thisObjectIndex, pairObjectIndex );
+			if ( pairDeltaR2 < nearestDeltaR2s[ thisObjectIndex ] )
+			{
+				nearestDeltaR2s[ thisObjectIndex ] = pairDeltaR2;
+				nearestNeighbours[ thisObjectIndex ] = pairObjectIndex;
+			}
+			if ( pairDeltaR2 < nearestDeltaR2s[ pairObjectIndex ] )
+			{
+				nearestDeltaR2s[ pairObjectIndex ] = pairDeltaR2;
+				nearestNeighbours[ pairObjectIndex ] = thisObjectIndex;
+			}
+		}
+		updateKt2( thisObjectIndex );
+	}
+	findMinKtTime += tick_count::now() - startKtTime;
+
+	unsigned int activeObjects = totalObjects;
+	while( activeObjects )
+	{
+		//Find min kt^2 value over all objects
+		tick_count const startKtTime = tick_count::now();
+		unsigned int thisMinIndex = firstActive;
+		double overallMinKt2 = cachedMinKts[ firstActive ];
+		for ( unsigned int thisObjectIndex = firstActive + 1; thisObjectIndex < lastActive; thisObjectIndex++ )
+		{
+			double cachedKt2 = cachedMinKts[ thisObjectIndex ];
+			if ( cachedKt2 < overallMinKt2 )
+			{
+				overallMinKt2 = cachedKt2;
+				thisMinIndex = thisObjectIndex;
+			}
+		}
+
+		//Beam distance wins if it is no larger than the pair distance
+		unsigned int pairMinIndex = nearestNeighbours[ thisMinIndex ];
+		if ( overallMinKt2 == apt2s[ thisMinIndex ] ) pairMinIndex = thisMinIndex;
+		findMinKtTime += tick_count::now() - startKtTime;
+
+		//Single objects as min kt are outputs, pairs get merged
+		tick_count const startUpdateTime = tick_count::now();
+		bool const isMerge = ( thisMinIndex != pairMinIndex );
+		if ( !isMerge )
+		{
+			//Make output TLV
+			outputs.push_back( TLorentzVector( pxs[ thisMinIndex ], pys[ thisMinIndex ], pzs[ thisMinIndex ], energies[ thisMinIndex ] ) );
+
+			//Remove jet from active data
+			wasDeleted[ thisMinIndex ] = true;
+			cachedMinKts[ thisMinIndex ] = DBL_MAX;
+		}
+		else
+		{
+			//Merge the pair
+			double const newPx = pxs[ thisMinIndex ] + pxs[ pairMinIndex ];
+			double const newPy = pys[ thisMinIndex ] + pys[ pairMinIndex ];
+			double const newPz = pzs[ thisMinIndex ] + pzs[ pairMinIndex ];
+			double const newE = energies[ thisMinIndex ] + energies[ pairMinIndex ];
+
+			//Replace the original object with the merge
+			dummy1.SetPxPyPzE( newPx, newPy, newPz, newE ); //for convenience
+			pts[ thisMinIndex ] = dummy1.Pt();
+			apt2s[ thisMinIndex ] = 1.0 / ( pts[ thisMinIndex ] * pts[ thisMinIndex ] );
+			pxs[ thisMinIndex ] = newPx;
+			pys[ thisMinIndex ] = newPy;
+			pzs[ thisMinIndex ] = newPz;
+			rapidities[ thisMinIndex ] = dummy1.Rapidity();
+			phis[ thisMinIndex ] = dummy1.Phi();
+			energies[ thisMinIndex ] = newE;
+
+			//Remove the pair object
+			wasDeleted[ pairMinIndex ] = true;
+			cachedMinKts[ pairMinIndex ] = DBL_MAX;
+		}
+
+		//Reduce the search ranges
+		while ( firstActive < lastActive && wasDeleted[ firstActive ] ) firstActive++;
+		while ( lastActive > firstActive && wasDeleted[ lastActive - 1 ] ) lastActive--;
+
+		//Update the neighbours: objects that lost their neighbour need a full search,
+		//every other object only has to check whether the merged object is now closer
+		if ( isMerge ) findNeighbour( thisMinIndex );
+		for ( unsigned int thisObjectIndex = firstActive; thisObjectIndex < lastActive; thisObjectIndex++ )
+		{
+			if ( wasDeleted[ thisObjectIndex ] || thisObjectIndex == thisMinIndex ) continue;
+
+			unsigned int const neighbour = nearestNeighbours[ thisObjectIndex ];
+			if ( neighbour == pairMinIndex || ( !isMerge && neighbour == thisMinIndex ) )
+			{
+				findNeighbour( thisObjectIndex );
+			}
+			else if ( isMerge )
+			{
+				double const mergedDeltaR2 = deltaR2( thisObjectIndex, thisMinIndex );
+				if ( neighbour == thisMinIndex )
+				{
+					//Still the nearest if it got closer, otherwise something else might be
+					if ( mergedDeltaR2 <= nearestDeltaR2s[ thisObjectIndex ] )
+					{
+						nearestDeltaR2s[ thisObjectIndex ] = mergedDeltaR2;
+						updateKt2( thisObjectIndex );
+					}
+					else
+					{
+						findNeighbour( thisObjectIndex );
+					}
+				}
+				else if ( mergedDeltaR2 < nearestDeltaR2s[ thisObjectIndex ] )
+				{
+					nearestDeltaR2s[ thisObjectIndex ] = mergedDeltaR2;
+					nearestNeighbours[ thisObjectIndex ] = thisMinIndex;
+					updateKt2( thisObjectIndex );
+				}
+			}
+		}
+
+		activeObjects--;
+		updateCollectionsTime += tick_count::now() - startUpdateTime;
+	}
+	cout << "Total time: " << ( tick_count::now() - startTime ).seconds() << " sec" << endl;
+	cout << "Kt finding time: " << findMinKtTime.seconds() << " sec" << endl;
+	cout << "Collection update time: " << updateCollectionsTime.seconds() << " sec" << endl;
+
+	sort( outputs.begin(), outputs.end(), SortJetsByPt );
+
+	//Output exactly like fastjet demo
+	printf("%5s %15s %15s %15s\n","jet #", "rapidity", "phi", "pt");
+	for ( unsigned int jetIndex = 0; jetIndex < outputs.size(); jetIndex++ )
+	{
+		//if ( outputs[ jetIndex ].Pt() < 5.0 ) break;
+		double phi = outputs[ jetIndex ].Phi();
+		while ( phi < 0.0 ) phi += TWO_PI;
+		printf( "%5u %15.8f %15.8f %15.8f\n",
+				jetIndex,
+				outputs[ jetIndex ].Rapidity(),
+				phi,
+				outputs[ jetIndex ].Pt() );
+	}
+
+	return 0;
+}